@@ -0,0 +1,167 @@
+/*
+  Path query cost and memory of includes/pathfinding.h on generated maps:
+  A* against jump point search on the same start/goal pairs (their path costs
+  have to match, both are optimal), and flow field builds against cache hits.
+
+  Maps are scattered walls plus long wall segments with gaps, the same seed
+  every run.
+
+  gcc -O2 -std=c99 bench/pathBench.c -o pathBench
+  emcc -O2 bench/pathBench.c -o pathBench.js
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../includes/pathfinding.h"
+
+#define BENCH_QUERIES 200
+#define BENCH_FLOW_RADIUS 24
+#define BENCH_FLOW_TARGETS 64
+#define BENCH_FLOW_LOOKUPS 1000000
+
+static unsigned int seed = 12345;
+
+static unsigned int
+Random()
+{
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8;
+}
+
+static double
+Seconds()
+{
+    return (double)clock() / CLOCKS_PER_SEC;
+}
+
+/* 1 in density tiles is a wall, plus a wall segment every 16 rows and columns with gaps */
+static void
+GenerateMap(uint8_t* blocked, int width, int height, int density)
+{
+    for (int i = 0; i < width * height; i++) {
+        blocked[i] = Random() % density == 0;
+    }
+    for (int y = 8; y < height; y += 16) {
+        for (int x = 0; x < width; x++) {
+            blocked[y * width + x] = (x % 24) > 2;
+        }
+    }
+    for (int x = 8; x < width; x += 16) {
+        for (int y = 0; y < height; y++) {
+            blocked[y * width + x] |= (y % 20) > 3 && (y % 20) < 18;
+        }
+    }
+}
+
+static int
+RandomOpenTile(const uint8_t* blocked, int tileCount)
+{
+    int tile;
+    do {
+        tile = (int)(Random() % (unsigned int)tileCount);
+    } while (blocked[tile]);
+    return tile;
+}
+
+static long
+PathCost(const int* tiles, int length, int start, int width)
+{
+    long cost = 0;
+    int previous = start;
+    for (int i = 0; i < length; i++) {
+        int diagonal = tiles[i] % width != previous % width && tiles[i] / width != previous / width;
+        cost += diagonal ? PATH_COST_DIAGONAL : PATH_COST_STRAIGHT;
+        previous = tiles[i];
+    }
+    return cost;
+}
+
+static void
+BenchMap(int size)
+{
+    int tileCount = size * size;
+    uint8_t* blocked = malloc((size_t)tileCount);
+    void* gridMemory = malloc(PathGridMemorySize(tileCount));
+    int* tiles = malloc(sizeof(int) * (size_t)tileCount);
+    int* starts = malloc(sizeof(int) * BENCH_QUERIES);
+    int* goals = malloc(sizeof(int) * BENCH_QUERIES);
+    GenerateMap(blocked, size, size, 5);
+    for (int i = 0; i < BENCH_QUERIES; i++) {
+        starts[i] = RandomOpenTile(blocked, tileCount);
+        goals[i] = RandomOpenTile(blocked, tileCount);
+    }
+
+    PathGrid grid;
+    PathGridInit(&grid, gridMemory, size, size, blocked);
+    printf("%dx%d map, grid memory %zu bytes (%zu per tile)\n", size, size,
+           PathGridMemorySize(tileCount), PathGridMemorySize(1));
+
+    long costs[BENCH_QUERIES];
+    const char* names[2] = {"A*", "jump points"};
+    for (int search = PATH_SEARCH_ASTAR; search <= PATH_SEARCH_JUMP; search++) {
+        long expanded = 0;
+        int found = 0;
+        int mismatches = 0;
+        double start = Seconds();
+        for (int i = 0; i < BENCH_QUERIES; i++) {
+            int length = PathFind(&grid, starts[i] % size, starts[i] / size, goals[i] % size, goals[i] / size,
+                                  tiles, tileCount, (PathSearch)search);
+            expanded += grid.expanded;
+            long cost = length == PATH_NOT_FOUND ? -1 : PathCost(tiles, length, starts[i], size);
+            found += length != PATH_NOT_FOUND;
+            if (search == PATH_SEARCH_ASTAR) {
+                costs[i] = cost;
+            } else if (costs[i] != cost) {
+                mismatches++;
+            }
+        }
+        double seconds = Seconds() - start;
+        printf("  %-12s %9.1f us/query %9.0f tiles expanded/query  %d/%d found", names[search],
+               seconds * 1e6 / BENCH_QUERIES, (double)expanded / BENCH_QUERIES, found, BENCH_QUERIES);
+        if (search == PATH_SEARCH_JUMP) {
+            printf("  %d cost mismatches", mismatches);
+        }
+        printf("\n");
+    }
+
+    /* Every target is a build the first time, then a cache hit */
+    void* flowMemory = malloc(PathFlowCacheMemorySize(BENCH_FLOW_RADIUS));
+    PathFlowCache cache;
+    PathFlowCacheInit(&cache, flowMemory, BENCH_FLOW_RADIUS);
+    double start = Seconds();
+    for (int i = 0; i < BENCH_FLOW_TARGETS; i++) {
+        PathFlowFieldFor(&cache, &grid, goals[i] % size, goals[i] / size);
+    }
+    double buildSeconds = Seconds() - start;
+
+    const PathFlowField* field = PathFlowFieldFor(&cache, &grid, goals[0] % size, goals[0] / size);
+    long reached = 0;
+    start = Seconds();
+    for (int i = 0; i < BENCH_FLOW_LOOKUPS; i++) {
+        int x = field->originX + i % cache.size;
+        int y = field->originY + (i / cache.size) % cache.size;
+        reached += PathFlowDirection(&cache, field, x, y) != PATH_NO_DIRECTION;
+    }
+    double lookupSeconds = Seconds() - start;
+    printf("  flow field   %9.1f us/build (radius %d, %zu bytes for %d fields)  %.1f ns/lookup (%ld reached)\n",
+           buildSeconds * 1e6 / BENCH_FLOW_TARGETS, BENCH_FLOW_RADIUS,
+           PathFlowCacheMemorySize(BENCH_FLOW_RADIUS), PATH_MAX_FLOW_FIELDS,
+           lookupSeconds * 1e9 / BENCH_FLOW_LOOKUPS, reached);
+
+    free(flowMemory);
+    free(goals);
+    free(starts);
+    free(tiles);
+    free(gridMemory);
+    free(blocked);
+}
+
+int
+main()
+{
+    int sizes[] = {64, 256, 1024};
+    for (int i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++) {
+        BenchMap(sizes[i]);
+    }
+    return 0;
+}
@@ -0,0 +1,242 @@
+/*
+  Throughput of the vector.h copy kernels and the operations built on them,
+  and how often the growth policy reallocates under push/pop/insert/delete churn.
+
+  gcc -O2 -std=c99 bench/vectorBench.c -o vectorBench                 (libc memmove/memcpy)
+  emcc -O2 -msimd128 bench/vectorBench.c -o vectorBench.js            (wasm SIMD128 kernel)
+  emcc -O2 bench/vectorBench.c -o vectorBench.js                      (wasm libc, to compare)
+*/
+#include <time.h>
+#include <stdlib.h>
+
+/* Count every realloc vector.h makes */
+static long reallocCount;
+static void*
+CountingRealloc(void* data, size_t size)
+{
+    reallocCount++;
+    return realloc(data, size);
+}
+#define realloc CountingRealloc
+#include "../includes/vector.h"
+#undef realloc
+
+#define BENCH_ELEMENTS 4096
+#define BENCH_SECONDS 0.25
+
+static double
+Seconds()
+{
+    return (double)clock() / CLOCKS_PER_SEC;
+}
+
+/* The old char at a time MemMove, kept as a baseline */
+static void*
+ByteMemMove(void* dst, const void* src, size_t size)
+{
+    volatile char* d = (char*)dst;
+    const char* s = (const char*)src;
+    if ((char*)d < s) {
+        while (size--) *d++ = *s++;
+    } else {
+        while (size--) d[size] = s[size];
+    }
+    return dst;
+}
+
+/* Every op shifts the whole array by one element, like VectorInsert/VectorDelete at index 0 */
+static void
+BenchCopy(size_t elemSize)
+{
+    size_t bytes = elemSize * BENCH_ELEMENTS;
+    unsigned char* buffer = malloc(bytes + elemSize);
+    memset(buffer, 1, bytes + elemSize);
+    
+    double mine = 0.0, libc = 0.0, byte = 0.0;
+    long ops = 0;
+    double start = Seconds();
+    while (Seconds() - start < BENCH_SECONDS) {
+        for (int i = 0; i < 64; i++, ops++) {
+            ByteMemMove(buffer + elemSize, buffer, bytes);
+            ByteMemMove(buffer, buffer + elemSize, bytes);
+        }
+    }
+    byte = (double)bytes * ops * 2 / (Seconds() - start) / 1e9;
+
+    ops = 0;
+    start = Seconds();
+    while (Seconds() - start < BENCH_SECONDS) {
+        for (int i = 0; i < 64; i++, ops++) {
+            MemMove(buffer + elemSize, buffer, bytes);
+            MemMove(buffer, buffer + elemSize, bytes);
+        }
+    }
+    mine = (double)bytes * ops * 2 / (Seconds() - start) / 1e9;
+
+    ops = 0;
+    start = Seconds();
+    while (Seconds() - start < BENCH_SECONDS) {
+        for (int i = 0; i < 64; i++, ops++) {
+            memmove(buffer + elemSize, buffer, bytes);
+            memmove(buffer, buffer + elemSize, bytes);
+        }
+    }
+    libc = (double)bytes * ops * 2 / (Seconds() - start) / 1e9;
+    
+    printf("  %4zu byte elements   MemMove %7.2f GB/s   memmove %7.2f GB/s   byte loop %7.2f GB/s\n",
+           elemSize, mine, libc, byte);
+    free(buffer);
+}
+
+/* Element of N bytes and a benchmark for the vector ops on it */
+#define DEFINE_VECTOR_BENCH(N)                                                        \
+typedef struct Element##N { unsigned char bytes[N]; } Element##N;                      \
+typedef vector(Element##N*) Vector##N;                                                 \
+static void                                                                            \
+BenchVector##N()                                                                       \
+{                                                                                      \
+    Vector##N vec;                                                                     \
+    Vector##N* v = &vec;                                                               \
+    Element##N e;                                                                      \
+    memset(&e, 7, sizeof(e));                                                          \
+    Vector(v);                                                                         \
+    for (int i = 0; i < BENCH_ELEMENTS; i++) VectorPush(v, e);                         \
+                                                                                       \
+    long ops = 0;                                                                      \
+    double start = Seconds();                                                          \
+    while (Seconds() - start < BENCH_SECONDS) {                                        \
+        for (int i = 0; i < 64; i++, ops++) {                                          \
+            VectorInsert(v, 0, e);                                                     \
+            VectorDelete(v, 0);                                                        \
+        }                                                                              \
+    }                                                                                  \
+    double elapsed = Seconds() - start;                                                \
+    printf("  %4d byte elements   insert+delete at 0: %9.0f pairs/s  %7.2f GB/s moved\n", \
+           N, ops / elapsed, (double)N * BENCH_ELEMENTS * ops * 2 / elapsed / 1e9);    \
+    free(v->data);                                                                     \
+}
+
+DEFINE_VECTOR_BENCH(1)
+DEFINE_VECTOR_BENCH(4)
+DEFINE_VECTOR_BENCH(8)
+DEFINE_VECTOR_BENCH(16)
+DEFINE_VECTOR_BENCH(32)
+DEFINE_VECTOR_BENCH(64)
+
+/* Capacity churn on int vectors, ops per second and reallocs per 1000 ops */
+typedef vector(int*) IntVector;
+
+static void
+ReportChurn(const char* name, long ops, double elapsed, long reallocs)
+{
+    printf("  %-34s %11.0f ops/s   %8.2f reallocs per 1000 ops\n",
+           name, ops / elapsed, reallocs * 1000.0 / ops);
+}
+
+static void
+BenchPushPop()
+{
+    IntVector vec;
+    IntVector* v = &vec;
+    Vector(v);
+    long ops = 0;
+    reallocCount = 0;
+    double start = Seconds();
+    while (Seconds() - start < BENCH_SECONDS) {
+        for (int i = 0; i < BENCH_ELEMENTS; i++, ops++) VectorPush(v, i);
+        for (int i = 0; i < BENCH_ELEMENTS; i++, ops++) VectorPop(v);
+    }
+    ReportChurn("push N then pop N", ops, Seconds() - start, reallocCount);
+    VectorFree(v);
+}
+
+/* Push/pop right at a capacity boundary, the worst case for a growth policy */
+static void
+BenchThreshold(int length)
+{
+    IntVector vec;
+    IntVector* v = &vec;
+    Vector(v);
+    for (int i = 0; i < length; i++) VectorPush(v, i);
+    long ops = 0;
+    reallocCount = 0;
+    double start = Seconds();
+    while (Seconds() - start < BENCH_SECONDS) {
+        for (int i = 0; i < 1024; i++, ops += 2) {
+            VectorPush(v, i);
+            VectorPop(v);
+        }
+    }
+    char name[64];
+    sprintf(name, "push/pop at length %d", length);
+    ReportChurn(name, ops, Seconds() - start, reallocCount);
+    VectorFree(v);
+}
+
+static void
+BenchInsertDelete()
+{
+    IntVector vec;
+    IntVector* v = &vec;
+    Vector(v);
+    for (int i = 0; i < BENCH_ELEMENTS; i++) VectorPush(v, i);
+    srand(1);
+    long ops = 0;
+    reallocCount = 0;
+    double start = Seconds();
+    while (Seconds() - start < BENCH_SECONDS) {
+        for (int i = 0; i < 1024; i++, ops += 2) {
+            VectorInsert(v, (size_t)rand() % VectorLen(v), i);
+            VectorDelete(v, (size_t)rand() % VectorLen(v));
+        }
+    }
+    ReportChurn("insert+delete at random index", ops, Seconds() - start, reallocCount);
+    VectorFree(v);
+}
+
+static void
+BenchReserve()
+{
+    IntVector vec;
+    IntVector* v = &vec;
+    long ops = 0;
+    reallocCount = 0;
+    double start = Seconds();
+    while (Seconds() - start < BENCH_SECONDS) {
+        Vector(v);
+        VectorReserve(v, BENCH_ELEMENTS);
+        for (int i = 0; i < BENCH_ELEMENTS; i++, ops++) VectorPush(v, i);
+        VectorShrinkToFit(v);
+        VectorFree(v);
+    }
+    ReportChurn("reserve N, push N, shrink to fit", ops, Seconds() - start, reallocCount);
+}
+
+int
+main()
+{
+    printf("SIMD width: %d bytes, %d elements per vector\n", VECTOR_SIMD_WIDTH, BENCH_ELEMENTS);
+    
+    printf("Copy kernels (shift by one element):\n");
+    size_t sizes[] = {1, 4, 8, 16, 32, 64};
+    for (int i = 0; i < (int)(sizeof(sizes)/sizeof(sizes[0])); i++) {
+        BenchCopy(sizes[i]);
+    }
+
+    printf("Vector operations:\n");
+    BenchVector1();
+    BenchVector4();
+    BenchVector8();
+    BenchVector16();
+    BenchVector32();
+    BenchVector64();
+
+    printf("Capacity churn:\n");
+    BenchPushPop();
+    BenchThreshold(BENCH_ELEMENTS);
+    BenchThreshold(BENCH_ELEMENTS / 2 + 1);
+    BenchThreshold(BENCH_ELEMENTS / 4);
+    BenchInsertDelete();
+    BenchReserve();
+    return 0;
+}
@@ -0,0 +1,87 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <string.h>
+
+/*
+  Linear allocator over a block handed to it, nothing is freed one at a time,
+  the whole arena is reset at once
+*/
+typedef struct Arena
+{
+    unsigned char* base;
+    size_t size;
+    size_t used;
+    size_t highWater;       // most bytes ever used at once
+    size_t overflowCount;   // pushes that didn't fit since the last check
+    size_t pushCount;       // successful pushes ever, for the profiler's allocation counter
+} Arena;
+
+#define ARENA_DEFAULT_ALIGN 16
+
+/* Usage */
+// Arena a; ArenaInit(&a, memory, size);
+// Thing* t = ArenaPushStruct(&a, Thing); int* n = ArenaPushArray(&a, int, 100);
+
+#define ArenaPushStruct(a,type)     ((type*)ArenaPushZero((a),sizeof(type),ARENA_DEFAULT_ALIGN))
+#define ArenaPushArray(a,type,n)    ((type*)ArenaPushZero((a),sizeof(type)*(n),ARENA_DEFAULT_ALIGN))
+#define ArenaRemaining(a)           ((a)->size - (a)->used)
+
+static void
+ArenaInit(Arena* arena, void* memory, size_t size)
+{
+    arena->base = (unsigned char*)memory;
+    arena->size = size;
+    arena->used = 0;
+    arena->highWater = 0;
+    arena->overflowCount = 0;
+    arena->pushCount = 0;
+}
+
+/* Returns NULL when the arena is out of space, align must be a power of two */
+static void*
+ArenaPush(Arena* arena, size_t size, size_t align)
+{
+    size_t address = (size_t)(arena->base + arena->used);
+    size_t padding = (align - (address & (align - 1))) & (align - 1);
+    if (padding + size > arena->size - arena->used) {
+        arena->overflowCount++;
+        return NULL;
+    }
+    arena->used += padding;
+    void* result = arena->base + arena->used;
+    arena->used += size;
+    arena->pushCount++;
+    if (arena->used > arena->highWater) {
+        arena->highWater = arena->used;
+    }
+    return result;
+}
+
+static void*
+ArenaPushZero(Arena* arena, size_t size, size_t align)
+{
+    void* result = ArenaPush(arena, size, align);
+    if (result) {
+        memset(result, 0, size);
+    }
+    return result;
+}
+
+/* Returns how many pushes failed since the last call and clears the count */
+static size_t
+ArenaTakeOverflows(Arena* arena)
+{
+    size_t overflows = arena->overflowCount;
+    arena->overflowCount = 0;
+    return overflows;
+}
+
+static void
+ArenaReset(Arena* arena)
+{
+    arena->used = 0;
+}
+
+#endif
@@ -0,0 +1,420 @@
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "../raylibIncludes/raylib.h"
+#include "hashmap.h"
+#include "jobs.h"
+
+/*
+  Asset manager for sprite atlases packed at build time by tools/atlasPacker.c.
+  An atlas is NAME.png plus NAME.atlas, the sprite table:
+
+    AtlasFileHeader
+    AtlasFileSprite sprites[spriteCount]    name key and where it is in the png
+
+  Atlases are acquired by name and reference counted. Handles are
+  (generation << 16) | slot like entity handles, a released and unloaded
+  atlas's old handles stop resolving. Releasing the last reference doesn't
+  unload anything, AssetCollect does, so the game decides when (between scenes).
+
+  Sprites are found by the key of their name in one hash lookup, whatever
+  atlas they're in. Everything drawn from one atlas is one texture, raylib
+  keeps it in one batch.
+
+  With jobs set the png is decoded on a worker, AssetUpdate uploads the
+  finished ones to textures on the main thread. Until then the atlas's
+  sprites draw as placeholders, AssetFinishLoading waits for one that has to
+  be there (before it's baked into something). On the web the decode's file
+  read needs the main thread, poll AssetLoading there instead of waiting.
+*/
+#define ASSET_MAX_ATLASES 16
+#define ASSET_MAX_SPRITES 1024
+#define ASSET_LOOKUP_CAPACITY 2048      // power of two, keep sprites under ~70% of it
+#define ASSET_ATLAS_LOOKUP_CAPACITY 32  // power of two
+#define ASSET_MAX_PATH 256
+#define ASSET_MAX_FAILED 16             // atlas names remembered as unloadable
+#define ASSET_NONE 0
+
+#define ATLAS_FILE_MAGIC "GATL"
+#define ATLAS_FILE_VERSION 1
+
+typedef uint32_t AssetHandle;
+
+typedef struct AtlasFileHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t spriteCount;
+    uint32_t width;
+    uint32_t height;
+} AtlasFileHeader;
+
+typedef struct AtlasFileSprite
+{
+    uint64_t name;      // AssetNameKey of the sprite's name
+    float x, y, width, height;
+} AtlasFileSprite;
+
+typedef struct AssetSprite
+{
+    Rectangle source;
+    int atlas;
+} AssetSprite;
+
+typedef struct AssetAtlas
+{
+    uint64_t name;      // 0 when the slot is free
+    Texture2D texture;  // id 0 when textures aren't loaded (headless) or the png is missing
+    int refCount;
+    uint16_t generation;
+    int firstSprite;    // sprites of one atlas are contiguous
+    int spriteCount;
+
+    /* png decoding as a job, only when the manager has jobs */
+    bool decoding;      // the job was started, image not uploaded yet
+    JobCounter decoded;
+    Image image;
+    char path[ASSET_MAX_PATH];
+} AssetAtlas;
+
+typedef struct AssetManager
+{
+    AssetAtlas atlases[ASSET_MAX_ATLASES];
+    HashMap atlasLookup;    // atlas name key -> slot
+    HashMap spriteLookup;   // sprite name key -> index into sprites
+    AssetSprite* sprites;
+    uint64_t* spriteNames;
+    int spriteCount;
+
+    const char* directory;  // prefix for atlas paths, kept not copied
+    bool loadTextures;      // false without a window, sprite tables still load
+    JobSystem* jobs;        // NULL decodes pngs when the atlas is acquired
+    unsigned int loadCount; // atlases loaded from disk so far
+
+    /* Atlases that are missing or invalid aren't tried (or logged) again */
+    uint64_t failed[ASSET_MAX_FAILED];
+    int failedCount;
+} AssetManager;
+
+/* Usage */
+// AssetManager a; AssetManagerInit(&a, ArenaPush(&arena, AssetManagerMemorySize, 16), "assets/", true);
+// AssetHandle h = AssetAcquire(&a, "items"); AssetDrawSprite(&a, AssetNameKey("sword"), dest, WHITE);
+// AssetRelease(&a, h); AssetCollect(&a);
+// a.jobs = &jobs; AssetUpdate(&a); /* every frame */ AssetFinishLoading(&a, h); or while (AssetLoading(&a, h)) ...
+
+#define AssetManagerMemorySize (HashMapMemorySize(ASSET_ATLAS_LOOKUP_CAPACITY) + HashMapMemorySize(ASSET_LOOKUP_CAPACITY) + \
+                                (sizeof(AssetSprite) + sizeof(uint64_t)) * ASSET_MAX_SPRITES)
+
+#define AssetSlot(h)        ((int)((h) & 0xffffu) - 1)
+#define AssetGeneration(h)  ((uint16_t)((h) >> 16))
+
+/* FNV-1a of the name through HashKey, never 0 */
+static uint64_t
+AssetNameKey(const char* name)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (const unsigned char* c = (const unsigned char*)name; *c; c++) {
+        hash = (hash ^ *c) * 0x100000001b3ull;
+    }
+    return HashKey(hash);
+}
+
+static void
+AssetManagerInit(AssetManager* manager, void* memory, const char* directory, bool loadTextures)
+{
+    memset(manager, 0, sizeof(AssetManager));
+    unsigned char* next = (unsigned char*)memory;
+    HashMapInit(&manager->atlasLookup, next, ASSET_ATLAS_LOOKUP_CAPACITY);
+    next += HashMapMemorySize(ASSET_ATLAS_LOOKUP_CAPACITY);
+    HashMapInit(&manager->spriteLookup, next, ASSET_LOOKUP_CAPACITY);
+    next += HashMapMemorySize(ASSET_LOOKUP_CAPACITY);
+    manager->spriteNames = (uint64_t*)next;
+    next += sizeof(uint64_t) * ASSET_MAX_SPRITES;
+    manager->sprites = (AssetSprite*)next;
+    manager->directory = directory;
+    manager->loadTextures = loadTextures;
+    for (int i = 0; i < ASSET_MAX_ATLASES; i++) {
+        manager->atlases[i].generation = 1;
+    }
+}
+
+/* JobFunction, atlas->path into atlas->image */
+static void
+AssetDecodeJob(void* data)
+{
+    AssetAtlas* atlas = (AssetAtlas*)data;
+    atlas->image = LoadImage(atlas->path);
+}
+
+/* Main thread only, the decode job has finished */
+static void
+AssetUploadAtlas(AssetAtlas* atlas)
+{
+    if (atlas->image.data) {
+        atlas->texture = LoadTextureFromImage(atlas->image);
+        UnloadImage(atlas->image);
+    }
+    memset(&atlas->image, 0, sizeof(Image));
+    atlas->decoding = false;
+}
+
+/* Reads NAME.atlas into the sprite tables and NAME.png into a texture (or starts decoding it).
+   1 when loaded, 0 when its sprites don't fit right now, -1 when the file is missing or invalid */
+static int
+AssetLoadAtlas(AssetManager* manager, int slot, const char* name)
+{
+    char path[ASSET_MAX_PATH];
+    if (snprintf(path, sizeof(path), "%s%s.atlas", manager->directory, name) >= (int)sizeof(path)) {
+        return -1;
+    }
+    int size = 0;
+    unsigned char* data = FileExists(path) ? LoadFileData(path, &size) : NULL;
+    if (!data) {
+        printf("%s: failed to open atlas.\n", path);
+        return -1;
+    }
+
+    AtlasFileHeader header;
+    int valid = size >= (int)sizeof(header);
+    if (valid) {
+        memcpy(&header, data, sizeof(header));
+        valid = memcmp(header.magic, ATLAS_FILE_MAGIC, 4) == 0 && header.version == ATLAS_FILE_VERSION &&
+            (size_t)size == sizeof(header) + sizeof(AtlasFileSprite) * (size_t)header.spriteCount;
+    }
+    if (!valid) {
+        printf("%s: not a version %d atlas.\n", path, ATLAS_FILE_VERSION);
+        UnloadFileData(data);
+        return -1;
+    }
+    if (manager->spriteCount + (int)header.spriteCount > ASSET_MAX_SPRITES) {
+        printf("%s: too many sprites loaded, %d more don't fit.\n", path, (int)header.spriteCount);
+        UnloadFileData(data);
+        return 0;
+    }
+
+    AssetAtlas* atlas = &manager->atlases[slot];
+    atlas->firstSprite = manager->spriteCount;
+    atlas->spriteCount = 0;
+    for (uint32_t i = 0; i < header.spriteCount; i++) {
+        AtlasFileSprite entry;
+        memcpy(&entry, data + sizeof(header) + sizeof(AtlasFileSprite) * i, sizeof(entry));
+        /* Sprite names are unique, a name another atlas already loaded stays with that atlas
+           and this copy is dropped, so unloading one atlas never removes another's names */
+        if (HashMapGet(&manager->spriteLookup, entry.name) != HASHMAP_NOT_FOUND) {
+            printf("%s: sprite %u has a name that is already loaded, skipped.\n", path, (unsigned)i);
+            continue;
+        }
+        int index = manager->spriteCount++;
+        manager->sprites[index].source = (Rectangle){entry.x, entry.y, entry.width, entry.height};
+        manager->sprites[index].atlas = slot;
+        manager->spriteNames[index] = entry.name;
+        HashMapPut(&manager->spriteLookup, entry.name, (uint32_t)index);
+        atlas->spriteCount++;
+    }
+    UnloadFileData(data);
+
+    memset(&atlas->texture, 0, sizeof(Texture2D));
+    if (manager->loadTextures) {
+        snprintf(atlas->path, sizeof(atlas->path), "%s%s.png", manager->directory, name);
+        if (manager->jobs) {
+            atlas->decoding = true;
+            atlas->decoded.pending = 0;
+            JobRun(manager->jobs, AssetDecodeJob, atlas, &atlas->decoded);
+        } else {
+            atlas->texture = LoadTexture(atlas->path);
+        }
+    }
+    manager->loadCount++;
+    return 1;
+}
+
+static bool
+AssetFailed(const AssetManager* manager, uint64_t key)
+{
+    for (int i = 0; i < manager->failedCount; i++) {
+        if (manager->failed[i] == key) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Loads the atlas the first time, ASSET_NONE when it couldn't be loaded */
+static AssetHandle
+AssetAcquire(AssetManager* manager, const char* name)
+{
+    uint64_t key = AssetNameKey(name);
+    uint32_t found = HashMapGet(&manager->atlasLookup, key);
+    int slot = found == HASHMAP_NOT_FOUND ? -1 : (int)found;
+    if (slot == -1) {
+        if (AssetFailed(manager, key)) {
+            return ASSET_NONE;
+        }
+        for (int i = 0; i < ASSET_MAX_ATLASES && slot == -1; i++) {
+            if (manager->atlases[i].name == 0) {
+                slot = i;
+            }
+        }
+        if (slot == -1) {
+            return ASSET_NONE;
+        }
+        int loaded = AssetLoadAtlas(manager, slot, name);
+        if (loaded != 1) {
+            /* Out of sprite space can pass after AssetCollect, a bad file won't */
+            if (loaded < 0 && manager->failedCount < ASSET_MAX_FAILED) {
+                manager->failed[manager->failedCount++] = key;
+            }
+            return ASSET_NONE;
+        }
+        manager->atlases[slot].name = key;
+        manager->atlases[slot].refCount = 0;
+        HashMapPut(&manager->atlasLookup, key, (uint32_t)slot);
+    }
+
+    AssetAtlas* atlas = &manager->atlases[slot];
+    atlas->refCount++;
+    return ((AssetHandle)atlas->generation << 16) | (AssetHandle)(slot + 1);
+}
+
+/* Stale and ASSET_NONE handles are ignored */
+static void
+AssetRelease(AssetManager* manager, AssetHandle handle)
+{
+    int slot = AssetSlot(handle);
+    if (handle == ASSET_NONE || slot < 0 || slot >= ASSET_MAX_ATLASES) {
+        return;
+    }
+    AssetAtlas* atlas = &manager->atlases[slot];
+    if (atlas->name != 0 && atlas->generation == AssetGeneration(handle) && atlas->refCount > 0) {
+        atlas->refCount--;
+    }
+}
+
+static void
+AssetUnloadAtlas(AssetManager* manager, int slot)
+{
+    AssetAtlas* atlas = &manager->atlases[slot];
+    if (atlas->decoding) {
+        JobWait(manager->jobs, &atlas->decoded);
+        UnloadImage(atlas->image);
+    }
+    if (atlas->texture.id != 0) {
+        UnloadTexture(atlas->texture);
+    }
+
+    /* Close the gap in the sprite array, later atlases' sprites move down */
+    int first = atlas->firstSprite;
+    int count = atlas->spriteCount;
+    for (int i = first; i < first + count; i++) {
+        HashMapRemove(&manager->spriteLookup, manager->spriteNames[i]);
+    }
+    for (int i = first + count; i < manager->spriteCount; i++) {
+        manager->sprites[i - count] = manager->sprites[i];
+        manager->spriteNames[i - count] = manager->spriteNames[i];
+        HashMapPut(&manager->spriteLookup, manager->spriteNames[i], (uint32_t)(i - count));
+    }
+    manager->spriteCount -= count;
+    for (int i = 0; i < ASSET_MAX_ATLASES; i++) {
+        if (manager->atlases[i].name != 0 && manager->atlases[i].firstSprite > first) {
+            manager->atlases[i].firstSprite -= count;
+        }
+    }
+
+    HashMapRemove(&manager->atlasLookup, atlas->name);
+    uint16_t generation = (uint16_t)(atlas->generation + 1);
+    memset(atlas, 0, sizeof(AssetAtlas));
+    atlas->generation = generation ? generation : 1;
+}
+
+/* Unloads every atlas nobody holds, returns how many */
+static int
+AssetCollect(AssetManager* manager)
+{
+    int unloaded = 0;
+    for (int i = 0; i < ASSET_MAX_ATLASES; i++) {
+        if (manager->atlases[i].name != 0 && manager->atlases[i].refCount == 0) {
+            AssetUnloadAtlas(manager, i);
+            unloaded++;
+        }
+    }
+    return unloaded;
+}
+
+/* Uploads every atlas whose png finished decoding, returns how many */
+static int
+AssetUpdate(AssetManager* manager)
+{
+    int uploaded = 0;
+    for (int i = 0; i < ASSET_MAX_ATLASES; i++) {
+        AssetAtlas* atlas = &manager->atlases[i];
+        if (atlas->decoding && JobDone(manager->jobs, &atlas->decoded)) {
+            AssetUploadAtlas(atlas);
+            uploaded++;
+        }
+    }
+    return uploaded;
+}
+
+/* Waits for the handle's png if it's still decoding and uploads it, stale handles are ignored */
+static void
+AssetFinishLoading(AssetManager* manager, AssetHandle handle)
+{
+    int slot = AssetSlot(handle);
+    if (handle == ASSET_NONE || slot < 0 || slot >= ASSET_MAX_ATLASES) {
+        return;
+    }
+    AssetAtlas* atlas = &manager->atlases[slot];
+    if (atlas->name != 0 && atlas->generation == AssetGeneration(handle) && atlas->decoding) {
+        JobWait(manager->jobs, &atlas->decoded);
+        AssetUploadAtlas(atlas);
+    }
+}
+
+/* True while the handle's png is still decoding, AssetUpdate uploads it once it's done */
+static inline bool
+AssetLoading(const AssetManager* manager, AssetHandle handle)
+{
+    int slot = AssetSlot(handle);
+    if (handle == ASSET_NONE || slot < 0 || slot >= ASSET_MAX_ATLASES) {
+        return false;
+    }
+    const AssetAtlas* atlas = &manager->atlases[slot];
+    return atlas->name != 0 && atlas->generation == AssetGeneration(handle) && atlas->decoding;
+}
+
+/* NULL unless an atlas with the sprite is loaded */
+static const AssetSprite*
+AssetFindSprite(const AssetManager* manager, uint64_t key)
+{
+    uint32_t index = HashMapGet(&manager->spriteLookup, key);
+    return index == HASHMAP_NOT_FOUND ? NULL : &manager->sprites[index];
+}
+
+/* false when the sprite or its texture isn't loaded, the caller draws a placeholder */
+static bool
+AssetDrawSprite(const AssetManager* manager, uint64_t key, Rectangle dest, Color tint)
+{
+    const AssetSprite* sprite = AssetFindSprite(manager, key);
+    if (!sprite || manager->atlases[sprite->atlas].texture.id == 0) {
+        return false;
+    }
+    DrawTexturePro(manager->atlases[sprite->atlas].texture, sprite->source, dest, (Vector2){0.f, 0.f}, 0.f, tint);
+    return true;
+}
+
+/* Everything, held or not */
+static void
+AssetManagerUnload(AssetManager* manager)
+{
+    for (int i = 0; i < ASSET_MAX_ATLASES; i++) {
+        if (manager->atlases[i].name != 0) {
+            AssetUnloadAtlas(manager, i);
+        }
+    }
+}
+
+#endif
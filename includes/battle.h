@@ -0,0 +1,219 @@
+#ifndef BATTLE_H
+#define BATTLE_H
+
+#include <stdint.h>
+#include <string.h>
+#include "rng.h"
+
+/*
+  Headless turn based battles, the party against shades and wraiths.
+  Every round everyone acts at once and it all lands together: attacks hit
+  a random living opponent minus its defense, drains put shadow on one that
+  ignores defense and wears off over the next rounds, heals go to the ally
+  with the least health left.
+
+  Stats are a structure of arrays over a fixed BATTLE_MAX_UNITS slots and a
+  round is a few passes over all of them. The action is three 0/1 masks and
+  dead or empty slots have alive 0, so every unit goes through the same math
+  and nothing branches on what a unit is. Only picking targets looks at who
+  is alive.
+
+  The seed decides every roll, the same seed and units play out the same.
+  A Battle has no pointers, copy it to try a move and throw the copy away.
+*/
+#define BATTLE_MAX_UNITS 16             // both sides together, a multiple of 8 so the passes vectorize
+#define BATTLE_MAX_ROUNDS 200           // a draw after this
+#define BATTLE_CRIT_MULTIPLIER 2.f
+#define BATTLE_SHADOW_DECAY 0.5f        // shadow left on a unit after it ticks
+#define BATTLE_ONGOING -1
+
+typedef enum BattleSide
+{
+    BATTLE_PARTY,
+    BATTLE_ENEMIES,
+    BATTLE_DRAW,                        // as a result, nobody won
+} BattleSide;
+
+typedef enum BattleAction
+{
+    BATTLE_ATTACK,
+    BATTLE_DRAIN,
+    BATTLE_HEAL,
+} BattleAction;
+
+typedef struct BattleStats
+{
+    float health;
+    float power;        // damage, shadow or healing per round
+    float defense;      // taken off every attack that hits it
+    float critChance;   // 0 to 1, a crit is BATTLE_CRIT_MULTIPLIER times the power
+    BattleAction action;
+} BattleStats;
+
+typedef struct Battle
+{
+    float health[BATTLE_MAX_UNITS];
+    float maxHealth[BATTLE_MAX_UNITS];
+    float power[BATTLE_MAX_UNITS];
+    float defense[BATTLE_MAX_UNITS];
+    float critChance[BATTLE_MAX_UNITS];
+    float shadow[BATTLE_MAX_UNITS];     // damage it takes next round
+    float alive[BATTLE_MAX_UNITS];      // 1 or 0
+    float attacks[BATTLE_MAX_UNITS];    // action masks, 1 or 0
+    float drains[BATTLE_MAX_UNITS];
+    float heals[BATTLE_MAX_UNITS];
+    int side[BATTLE_MAX_UNITS];
+    int target[BATTLE_MAX_UNITS];
+    int count;
+    int round;
+    Rng rng;
+} Battle;
+
+/* Usage */
+// Battle b; BattleInit(&b, seed); BattleAdd(&b, BATTLE_PARTY, &alchemist); BattleAdd(&b, BATTLE_ENEMIES, &shade);
+// int winner = BattleRun(&b);   /* or BattleRound(&b) until it isn't BATTLE_ONGOING */
+// Battle ahead = b; BattleRound(&ahead);   /* look ahead */
+
+static void
+BattleInit(Battle* battle, uint64_t seed)
+{
+    memset(battle, 0, sizeof(Battle));
+    RngSeed(&battle->rng, seed, 0);
+}
+
+/* Slot of the new unit, -1 when the battle is full */
+static int
+BattleAdd(Battle* battle, BattleSide side, const BattleStats* stats)
+{
+    if (battle->count >= BATTLE_MAX_UNITS) {
+        return -1;
+    }
+    int i = battle->count++;
+    battle->health[i] = stats->health;
+    battle->maxHealth[i] = stats->health;
+    battle->power[i] = stats->power;
+    battle->defense[i] = stats->defense;
+    battle->critChance[i] = stats->critChance;
+    battle->shadow[i] = 0.f;
+    battle->alive[i] = (float)(stats->health > 0.f);
+    battle->attacks[i] = (float)(stats->action == BATTLE_ATTACK);
+    battle->drains[i] = (float)(stats->action == BATTLE_DRAIN);
+    battle->heals[i] = (float)(stats->action == BATTLE_HEAL);
+    battle->side[i] = side;
+    return i;
+}
+
+/* BATTLE_ONGOING while both sides have someone standing */
+static int
+BattleWinner(const Battle* battle)
+{
+    float standing[2] = {0.f, 0.f};
+    for (int i = 0; i < BATTLE_MAX_UNITS; i++) {
+        standing[battle->side[i]] += battle->alive[i];
+    }
+    if (standing[BATTLE_PARTY] == 0.f && standing[BATTLE_ENEMIES] == 0.f) {
+        return BATTLE_DRAW;
+    }
+    if (standing[BATTLE_ENEMIES] == 0.f) {
+        return BATTLE_PARTY;
+    }
+    if (standing[BATTLE_PARTY] == 0.f) {
+        return BATTLE_ENEMIES;
+    }
+    return battle->round >= BATTLE_MAX_ROUNDS ? BATTLE_DRAW : BATTLE_ONGOING;
+}
+
+/* A random living opponent, or the weakest living ally for healers. Every unit draws, dead or not */
+static void
+BattleChooseTargets(Battle* battle)
+{
+    int living[2][BATTLE_MAX_UNITS];
+    int livingCount[2] = {0, 0};
+    int weakest[2] = {0, 0};
+    float weakestHealth[2] = {2.f, 2.f};    // fraction of max health
+    for (int i = 0; i < battle->count; i++) {
+        if (battle->alive[i] == 0.f) {
+            continue;
+        }
+        int side = battle->side[i];
+        living[side][livingCount[side]++] = i;
+        float health = battle->health[i] / battle->maxHealth[i];
+        if (health < weakestHealth[side]) {
+            weakestHealth[side] = health;
+            weakest[side] = i;
+        }
+    }
+
+    for (int i = 0; i < battle->count; i++) {
+        int opponents = 1 - battle->side[i];
+        uint32_t roll = RngNext(&battle->rng);
+        int pick = (int)(((uint64_t)roll * (uint32_t)livingCount[opponents]) >> 32);
+        int foe = livingCount[opponents] > 0 ? living[opponents][pick] : i;
+        battle->target[i] = battle->heals[i] != 0.f ? weakest[battle->side[i]] : foe;
+    }
+}
+
+/* One round, returns the winner once there is one */
+static int
+BattleRound(Battle* battle)
+{
+    float crit[BATTLE_MAX_UNITS];
+    float hit[BATTLE_MAX_UNITS];
+    float targetDefense[BATTLE_MAX_UNITS];
+    float damage[BATTLE_MAX_UNITS];
+    float incoming[BATTLE_MAX_UNITS] = {0};
+    float shadowAdded[BATTLE_MAX_UNITS] = {0};
+    float healing[BATTLE_MAX_UNITS] = {0};
+
+    BattleChooseTargets(battle);
+    for (int i = 0; i < BATTLE_MAX_UNITS; i++) {
+        crit[i] = (float)(RngFloat(&battle->rng) < battle->critChance[i]);
+    }
+
+    /* What everyone does this round, the dead and empty slots do 0 */
+    for (int i = 0; i < BATTLE_MAX_UNITS; i++) {
+        hit[i] = battle->alive[i] * battle->power[i] * (1.f + crit[i] * (BATTLE_CRIT_MULTIPLIER - 1.f));
+    }
+    for (int i = 0; i < BATTLE_MAX_UNITS; i++) {
+        targetDefense[i] = battle->defense[battle->target[i]];
+    }
+    /* Selects rather than fmaxf/fminf, those keep NaN rules that stop them becoming vector max/min */
+    for (int i = 0; i < BATTLE_MAX_UNITS; i++) {
+        float through = hit[i] - targetDefense[i];
+        damage[i] = (through > 0.f ? through : 0.f) * battle->attacks[i];
+    }
+
+    /* Onto the targets, several units can pick the same one */
+    for (int i = 0; i < BATTLE_MAX_UNITS; i++) {
+        int target = battle->target[i];
+        incoming[target] += damage[i];
+        shadowAdded[target] += hit[i] * battle->drains[i];
+        healing[target] += hit[i] * battle->heals[i];
+    }
+
+    /* Everything lands at once, the last round's shadow ticks first and fades. Nobody comes back */
+    for (int i = 0; i < BATTLE_MAX_UNITS; i++) {
+        float health = battle->health[i] - incoming[i] - battle->shadow[i] + healing[i];
+        health = health > 0.f ? health : 0.f;
+        health = health < battle->maxHealth[i] ? health : battle->maxHealth[i];
+        battle->health[i] = health * battle->alive[i];
+        battle->shadow[i] = (battle->shadow[i] * BATTLE_SHADOW_DECAY + shadowAdded[i]) * battle->alive[i];
+        battle->alive[i] = (float)(battle->health[i] > 0.f);
+    }
+
+    battle->round++;
+    return BattleWinner(battle);
+}
+
+/* Rounds until someone wins, BATTLE_PARTY, BATTLE_ENEMIES or BATTLE_DRAW */
+static int
+BattleRun(Battle* battle)
+{
+    int winner = BattleWinner(battle);
+    while (winner == BATTLE_ONGOING) {
+        winner = BattleRound(battle);
+    }
+    return winner;
+}
+
+#endif
@@ -0,0 +1,267 @@
+#ifndef CONTAINERS_H
+#define CONTAINERS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+
+/*
+  Typed containers, one set of static inline functions per element type.
+  Unlike the vector.h macros every argument is evaluated once and the compiler
+  checks the element type.
+
+  DEFINE_ARRAY(Name, T)           growable array on the heap
+  DEFINE_SMALL_ARRAY(Name, T, N)  first N elements stored inline, heap after that
+  DEFINE_RING(Name, T, N)         fixed size FIFO, N must be a power of two, never allocates
+
+  Define CONTAINERS_BOUNDS_CHECK before including to abort on a bad index or an
+  empty pop, without it the checks compile to nothing.
+*/
+
+/* Usage */
+// DEFINE_ARRAY(IntArray, int)
+// IntArray a; IntArrayInit(&a); IntArrayPush(&a, 5); int x = *IntArrayAt(&a, 0); IntArrayFree(&a);
+
+#ifdef CONTAINERS_BOUNDS_CHECK
+#define ContainerCheck(cond, what)                                              \
+    do {                                                                        \
+        if (!(cond)) {                                                          \
+            fprintf(stderr, "%s:%d: container check failed: %s\n",              \
+                    __FILE__, __LINE__, (what));                                \
+            abort();                                                            \
+        }                                                                       \
+    } while (0)
+#else
+#define ContainerCheck(cond, what) ((void)0)
+#endif
+
+#define CONTAINER_MIN_CAPACITY 4
+
+/* DYNAMIC ARRAY */
+#define DEFINE_ARRAY(Name, T)                                                   \
+typedef struct Name                                                             \
+{                                                                               \
+    T* data;                                                                    \
+    size_t length;                                                              \
+    size_t capacity;                                                            \
+} Name;                                                                         \
+                                                                                \
+static inline void                                                              \
+Name##Init(Name* a)                                                             \
+{                                                                               \
+    a->data = NULL;                                                             \
+    a->length = 0;                                                              \
+    a->capacity = 0;                                                            \
+}                                                                               \
+                                                                                \
+static inline void                                                              \
+Name##Free(Name* a)                                                             \
+{                                                                               \
+    free(a->data);                                                              \
+    Name##Init(a);                                                              \
+}                                                                               \
+                                                                                \
+/* 0 when the allocation failed, the array is unchanged */                      \
+static inline int                                                               \
+Name##Reserve(Name* a, size_t capacity)                                         \
+{                                                                               \
+    if (capacity <= a->capacity) {                                              \
+        return 1;                                                               \
+    }                                                                           \
+    T* data = (T*)realloc(a->data, sizeof(T) * capacity);                       \
+    if (!data) {                                                                \
+        return 0;                                                               \
+    }                                                                           \
+    a->data = data;                                                             \
+    a->capacity = capacity;                                                     \
+    return 1;                                                                   \
+}                                                                               \
+                                                                                \
+static inline int                                                               \
+Name##Push(Name* a, T value)                                                    \
+{                                                                               \
+    if (a->length == a->capacity &&                                             \
+        !Name##Reserve(a, a->capacity ? a->capacity * 2 : CONTAINER_MIN_CAPACITY)) { \
+        return 0;                                                               \
+    }                                                                           \
+    a->data[a->length++] = value;                                               \
+    return 1;                                                                   \
+}                                                                               \
+                                                                                \
+static inline T                                                                 \
+Name##Pop(Name* a)                                                              \
+{                                                                               \
+    ContainerCheck(a->length > 0, #Name "Pop on an empty array");               \
+    return a->data[--a->length];                                                \
+}                                                                               \
+                                                                                \
+static inline T*                                                                \
+Name##At(Name* a, size_t i)                                                     \
+{                                                                               \
+    ContainerCheck(i < a->length, #Name "At index out of range");               \
+    return &a->data[i];                                                         \
+}                                                                               \
+                                                                                \
+/* Moves the last element into i, O(1) but doesn't keep order */               \
+static inline void                                                              \
+Name##SwapRemove(Name* a, size_t i)                                             \
+{                                                                               \
+    ContainerCheck(i < a->length, #Name "SwapRemove index out of range");       \
+    a->data[i] = a->data[--a->length];                                          \
+}                                                                               \
+                                                                                \
+static inline void                                                              \
+Name##Clear(Name* a)                                                            \
+{                                                                               \
+    a->length = 0;                                                              \
+}
+
+/*
+  SMALL BUFFER ARRAY
+  heap is NULL while everything fits in the inline storage, always go through
+  Name##Data so the struct can be copied without pointing into the old copy
+*/
+#define DEFINE_SMALL_ARRAY(Name, T, N)                                          \
+typedef struct Name                                                             \
+{                                                                               \
+    T* heap;                                                                    \
+    size_t length;                                                              \
+    size_t capacity;                                                            \
+    T inlineData[N];                                                            \
+} Name;                                                                         \
+                                                                                \
+static inline void                                                              \
+Name##Init(Name* a)                                                             \
+{                                                                               \
+    a->heap = NULL;                                                             \
+    a->length = 0;                                                              \
+    a->capacity = (N);                                                          \
+}                                                                               \
+                                                                                \
+static inline void                                                              \
+Name##Free(Name* a)                                                             \
+{                                                                               \
+    free(a->heap);                                                              \
+    Name##Init(a);                                                              \
+}                                                                               \
+                                                                                \
+static inline T*                                                                \
+Name##Data(Name* a)                                                             \
+{                                                                               \
+    return a->heap ? a->heap : a->inlineData;                                   \
+}                                                                               \
+                                                                                \
+static inline int                                                               \
+Name##Reserve(Name* a, size_t capacity)                                         \
+{                                                                               \
+    if (capacity <= a->capacity) {                                              \
+        return 1;                                                               \
+    }                                                                           \
+    T* data = (T*)realloc(a->heap, sizeof(T) * capacity);                       \
+    if (!data) {                                                                \
+        return 0;                                                               \
+    }                                                                           \
+    if (!a->heap) {                                                             \
+        memcpy(data, a->inlineData, sizeof(T) * a->length);                     \
+    }                                                                           \
+    a->heap = data;                                                             \
+    a->capacity = capacity;                                                     \
+    return 1;                                                                   \
+}                                                                               \
+                                                                                \
+static inline int                                                               \
+Name##Push(Name* a, T value)                                                    \
+{                                                                               \
+    if (a->length == a->capacity && !Name##Reserve(a, a->capacity * 2)) {       \
+        return 0;                                                               \
+    }                                                                           \
+    Name##Data(a)[a->length++] = value;                                         \
+    return 1;                                                                   \
+}                                                                               \
+                                                                                \
+static inline T                                                                 \
+Name##Pop(Name* a)                                                              \
+{                                                                               \
+    ContainerCheck(a->length > 0, #Name "Pop on an empty array");               \
+    return Name##Data(a)[--a->length];                                          \
+}                                                                               \
+                                                                                \
+static inline T*                                                                \
+Name##At(Name* a, size_t i)                                                     \
+{                                                                               \
+    ContainerCheck(i < a->length, #Name "At index out of range");               \
+    return &Name##Data(a)[i];                                                   \
+}                                                                               \
+                                                                                \
+static inline void                                                              \
+Name##SwapRemove(Name* a, size_t i)                                             \
+{                                                                               \
+    ContainerCheck(i < a->length, #Name "SwapRemove index out of range");       \
+    T* data = Name##Data(a);                                                    \
+    data[i] = data[--a->length];                                                \
+}                                                                               \
+                                                                                \
+static inline void                                                              \
+Name##Clear(Name* a)                                                            \
+{                                                                               \
+    a->length = 0;                                                              \
+}
+
+/* RING BUFFER - head/tail only ever increase, masked on access */
+#define DEFINE_RING(Name, T, N)                                                 \
+typedef struct Name                                                             \
+{                                                                               \
+    size_t head;                                                                \
+    size_t tail;                                                                \
+    T data[N];                                                                  \
+} Name;                                                                         \
+                                                                                \
+typedef char Name##CapacityIsPowerOfTwo[((N) & ((N) - 1)) == 0 ? 1 : -1];        \
+                                                                                \
+static inline void                                                              \
+Name##Init(Name* r)                                                             \
+{                                                                               \
+    r->head = 0;                                                                \
+    r->tail = 0;                                                                \
+}                                                                               \
+                                                                                \
+static inline size_t                                                            \
+Name##Count(const Name* r)                                                      \
+{                                                                               \
+    return r->tail - r->head;                                                   \
+}                                                                               \
+                                                                                \
+static inline int                                                               \
+Name##Full(const Name* r)                                                       \
+{                                                                               \
+    return Name##Count(r) == (N);                                               \
+}                                                                               \
+                                                                                \
+/* 0 when the ring is full, the value is dropped */                             \
+static inline int                                                               \
+Name##Push(Name* r, T value)                                                    \
+{                                                                               \
+    if (Name##Full(r)) {                                                        \
+        return 0;                                                               \
+    }                                                                           \
+    r->data[r->tail++ & ((N) - 1)] = value;                                     \
+    return 1;                                                                   \
+}                                                                               \
+                                                                                \
+static inline T                                                                 \
+Name##Pop(Name* r)                                                              \
+{                                                                               \
+    ContainerCheck(Name##Count(r) > 0, #Name "Pop on an empty ring");           \
+    return r->data[r->head++ & ((N) - 1)];                                      \
+}                                                                               \
+                                                                                \
+/* i = 0 is the oldest element */                                               \
+static inline T*                                                                \
+Name##At(Name* r, size_t i)                                                     \
+{                                                                               \
+    ContainerCheck(i < Name##Count(r), #Name "At index out of range");          \
+    return &r->data[(r->head + i) & ((N) - 1)];                                 \
+}
+
+#endif
@@ -0,0 +1,200 @@
+#ifndef ENTITIES_H
+#define ENTITIES_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+  Entity store, every component is its own dense array and entry i of each
+  array belongs to entities[i]. Systems loop 0..count over the arrays they
+  need, no pointers to chase. Removing an entity moves the last one into its
+  place so the arrays never have holes.
+
+  An Entity handle is (generation << ENTITY_INDEX_BITS) | slot. The slot maps to
+  the entity's current dense index, the generation goes up every time a slot
+  is reused so a handle to a destroyed entity stops resolving.
+  Handle 0 is never given out.
+*/
+typedef uint32_t Entity;
+
+#define ENTITY_NONE 0
+#define ENTITY_INDEX_BITS 16
+#define ENTITY_INDEX_MASK ((1u << ENTITY_INDEX_BITS) - 1)
+#define ENTITY_MAX_CAPACITY (1 << ENTITY_INDEX_BITS)
+
+#define EntitySlot(e)           ((e) & ENTITY_INDEX_MASK)
+#define EntityGeneration(e)     ((e) >> ENTITY_INDEX_BITS)
+
+/* Which optional components an entity has, one bit each */
+typedef enum EntityComponents
+{
+    COMPONENT_VELOCITY = 1 << 0,
+    COMPONENT_HEALTH   = 1 << 1,
+    COMPONENT_SPRITE   = 1 << 2,
+} EntityComponents;
+
+typedef struct EntityStore
+{
+    int capacity;
+    int count;
+
+    /* per slot, free slots are chained through slotDense */
+    uint16_t* generations;
+    int* slotDense;
+    int freeSlot;
+
+    /* dense, one entry per live entity */
+    Entity* entities;
+    uint32_t* components;
+    uint8_t* kinds;
+    float* positionX;
+    float* positionY;
+    float* previousX;       // position before the last simulation step, for interpolating
+    float* previousY;
+    float* velocityX;
+    float* velocityY;
+    float* sizeX;
+    float* sizeY;
+    float* health;
+    float* maxHealth;
+    int* sprites;
+} EntityStore;
+
+/* Usage */
+// EntityStore s; EntityStoreInit(&s, ArenaPush(&arena, EntityStoreMemorySize(1024), 16), 1024);
+// Entity e = EntityCreate(&s, KIND); int i = EntityIndex(&s, e); s.positionX[i] = 10.f;
+
+#define ENTITY_SLOT_BYTES   (sizeof(uint16_t) + sizeof(int))
+#define ENTITY_DENSE_BYTES  (sizeof(Entity) + sizeof(uint32_t) + sizeof(uint8_t) + sizeof(float) * 10 + sizeof(int))
+#define EntityStoreMemorySize(cap) ((ENTITY_SLOT_BYTES + ENTITY_DENSE_BYTES) * (size_t)(cap) + 16 * 16) // 16 arrays, up to 15 bytes padding each
+
+/* Carves the next array out of memory, 16 byte aligned so loops over them can vectorize */
+static inline void*
+EntityStoreTake(unsigned char** memory, size_t size)
+{
+    size_t address = (size_t)*memory;
+    unsigned char* result = *memory + ((16 - (address & 15)) & 15);
+    *memory = result + size;
+    return result;
+}
+
+/* capacity must not be more than ENTITY_MAX_CAPACITY */
+static inline void
+EntityStoreInit(EntityStore* store, void* memory, int capacity)
+{
+    unsigned char* next = (unsigned char*)memory;
+    size_t n = (size_t)capacity;
+
+    store->capacity = capacity;
+    store->count = 0;
+    store->generations = (uint16_t*)EntityStoreTake(&next, sizeof(uint16_t) * n);
+    store->slotDense   = (int*)EntityStoreTake(&next, sizeof(int) * n);
+    store->entities    = (Entity*)EntityStoreTake(&next, sizeof(Entity) * n);
+    store->components  = (uint32_t*)EntityStoreTake(&next, sizeof(uint32_t) * n);
+    store->kinds       = (uint8_t*)EntityStoreTake(&next, sizeof(uint8_t) * n);
+    store->positionX   = (float*)EntityStoreTake(&next, sizeof(float) * n);
+    store->positionY   = (float*)EntityStoreTake(&next, sizeof(float) * n);
+    store->previousX   = (float*)EntityStoreTake(&next, sizeof(float) * n);
+    store->previousY   = (float*)EntityStoreTake(&next, sizeof(float) * n);
+    store->velocityX   = (float*)EntityStoreTake(&next, sizeof(float) * n);
+    store->velocityY   = (float*)EntityStoreTake(&next, sizeof(float) * n);
+    store->sizeX       = (float*)EntityStoreTake(&next, sizeof(float) * n);
+    store->sizeY       = (float*)EntityStoreTake(&next, sizeof(float) * n);
+    store->health      = (float*)EntityStoreTake(&next, sizeof(float) * n);
+    store->maxHealth   = (float*)EntityStoreTake(&next, sizeof(float) * n);
+    store->sprites     = (int*)EntityStoreTake(&next, sizeof(int) * n);
+
+    /* slot 0 generation starts at 1 so no handle is ever 0 */
+    memset(store->generations, 0, sizeof(uint16_t) * n);
+    store->generations[0] = 1;
+    for (int i = 0; i < capacity; i++) {
+        store->slotDense[i] = i + 1 < capacity ? -(i + 2) : 0;
+    }
+    store->freeSlot = capacity > 0 ? 0 : -1;
+}
+
+/* Dense index of a live entity, -1 when the handle is stale */
+static inline int
+EntityIndex(const EntityStore* store, Entity entity)
+{
+    uint32_t slot = EntitySlot(entity);
+    if (entity == ENTITY_NONE || slot >= (uint32_t)store->capacity ||
+        store->generations[slot] != EntityGeneration(entity) || store->slotDense[slot] <= 0) {
+        return -1;
+    }
+    return store->slotDense[slot] - 1;
+}
+
+static inline int
+EntityAlive(const EntityStore* store, Entity entity)
+{
+    return EntityIndex(store, entity) != -1;
+}
+
+/* All components start zeroed, ENTITY_NONE when the store is full */
+static inline Entity
+EntityCreate(EntityStore* store, uint8_t kind)
+{
+    if (store->freeSlot < 0) {
+        return ENTITY_NONE;
+    }
+    int slot = store->freeSlot;
+    int nextFree = store->slotDense[slot];
+    store->freeSlot = nextFree < 0 ? -nextFree - 1 : -1;
+
+    int i = store->count++;
+    Entity entity = ((Entity)store->generations[slot] << ENTITY_INDEX_BITS) | (Entity)slot;
+    /* dense index is stored +1 so 0 and negatives mean free */
+    store->slotDense[slot] = i + 1;
+    store->entities[i] = entity;
+    store->components[i] = 0;
+    store->kinds[i] = kind;
+    store->positionX[i] = store->positionY[i] = 0.f;
+    store->previousX[i] = store->previousY[i] = 0.f;
+    store->velocityX[i] = store->velocityY[i] = 0.f;
+    store->sizeX[i] = store->sizeY[i] = 0.f;
+    store->health[i] = store->maxHealth[i] = 0.f;
+    store->sprites[i] = 0;
+    return entity;
+}
+
+/* Swap remove, the last entity takes the destroyed one's dense index */
+static inline int
+EntityDestroy(EntityStore* store, Entity entity)
+{
+    int i = EntityIndex(store, entity);
+    if (i == -1) {
+        return 0;
+    }
+    int last = --store->count;
+    if (i != last) {
+        store->entities[i]   = store->entities[last];
+        store->components[i] = store->components[last];
+        store->kinds[i]      = store->kinds[last];
+        store->positionX[i]  = store->positionX[last];
+        store->positionY[i]  = store->positionY[last];
+        store->previousX[i]  = store->previousX[last];
+        store->previousY[i]  = store->previousY[last];
+        store->velocityX[i]  = store->velocityX[last];
+        store->velocityY[i]  = store->velocityY[last];
+        store->sizeX[i]      = store->sizeX[last];
+        store->sizeY[i]      = store->sizeY[last];
+        store->health[i]     = store->health[last];
+        store->maxHealth[i]  = store->maxHealth[last];
+        store->sprites[i]    = store->sprites[last];
+        store->slotDense[EntitySlot(store->entities[i])] = i + 1;
+    }
+
+    /* new generation for the slot, 0 is skipped for slot 0 so no handle is 0 */
+    uint32_t slot = EntitySlot(entity);
+    store->generations[slot]++;
+    if (slot == 0 && store->generations[slot] == 0) {
+        store->generations[slot] = 1;
+    }
+    store->slotDense[slot] = store->freeSlot >= 0 ? -(store->freeSlot + 1) : 0;
+    store->freeSlot = (int)slot;
+    return 1;
+}
+
+#endif
@@ -0,0 +1,196 @@
+#ifndef FLOORGEN_H
+#define FLOORGEN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "rng.h"
+
+/*
+  Shadow tower floors, rooms joined by corridors, generated from a seed.
+  Output is the map's tile types, one int per tile row by row, same as
+  LoadCSVGameMap reads once it's a csv. The same seed
+  and size always make the same floor, on any platform.
+
+  FloorJob is a floor to generate as a job (includes/jobs.h), the game
+  generates the next floor on a worker while the current one is played.
+*/
+#define FLOOR_MIN_SIZE 16
+#define FLOOR_MAX_ROOMS 48
+#define FLOOR_ROOM_MIN_SIZE 4
+#define FLOOR_ROOM_MAX_SIZE 12
+#define FLOOR_ROOM_ATTEMPTS 300
+#define FLOOR_TILES_PER_ROOM 120    // room count target is tiles / this
+#define FLOOR_TORCH_ODDS 10         // 1 in this many room wall tiles gets a torch
+
+/* Same values as the game's TileType */
+typedef enum FloorTile
+{
+    FLOOR_TILE_FLOOR,
+    FLOOR_TILE_WALL,
+    FLOOR_TILE_TORCH,
+    FLOOR_TILE_STAIRS,
+} FloorTile;
+
+typedef struct FloorRoom
+{
+    int x;
+    int y;
+    int width;
+    int height;
+} FloorRoom;
+
+typedef struct FloorLayout
+{
+    int width;
+    int height;
+    int startX;         // where the player comes in, in the first room
+    int startY;
+    int stairsX;        // up to the next floor, in the room furthest from the start
+    int stairsY;
+    int roomCount;
+    FloorRoom rooms[FLOOR_MAX_ROOMS];
+} FloorLayout;
+
+/* FloorGenerateJob's data, tiles hold width * height ints */
+typedef struct FloorJob
+{
+    int* tiles;
+    FloorLayout layout;
+    int width;
+    int height;
+    uint64_t seed;
+} FloorJob;
+
+/* Usage */
+// FloorLayout l; FloorGenerate(tiles, &l, 64, 64, seed);
+// FloorJob job = {tiles, {0}, 64, 64, seed}; JobRun(&jobs, FloorGenerateJob, &job, &counter);
+
+static void
+FloorCarve(int* tiles, int width, int x, int y, int w, int h)
+{
+    for (int row = y; row < y + h; row++) {
+        for (int column = x; column < x + w; column++) {
+            tiles[row * width + column] = FLOOR_TILE_FLOOR;
+        }
+    }
+}
+
+/* Rooms keep a wall between them, corridors can still run along it */
+static bool
+FloorRoomOverlaps(const FloorLayout* layout, const FloorRoom* room)
+{
+    for (int i = 0; i < layout->roomCount; i++) {
+        const FloorRoom* other = &layout->rooms[i];
+        if (room->x - 1 < other->x + other->width && other->x - 1 < room->x + room->width &&
+            room->y - 1 < other->y + other->height && other->y - 1 < room->y + room->height) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* width and height at least FLOOR_MIN_SIZE */
+static void
+FloorGenerate(int* tiles, FloorLayout* layout, int width, int height, uint64_t seed)
+{
+    Rng rng;
+    RngSeed(&rng, seed, 0);
+    memset(layout, 0, sizeof(FloorLayout));
+    layout->width = width;
+    layout->height = height;
+    for (int i = 0; i < width * height; i++) {
+        tiles[i] = FLOOR_TILE_WALL;
+    }
+
+    /* Rooms anywhere they fit, the outer ring of tiles stays wall */
+    int targetRooms = width * height / FLOOR_TILES_PER_ROOM;
+    targetRooms = targetRooms < 2 ? 2 : targetRooms > FLOOR_MAX_ROOMS ? FLOOR_MAX_ROOMS : targetRooms;
+    int maxRoomSize = FLOOR_ROOM_MAX_SIZE < width / 3 ? FLOOR_ROOM_MAX_SIZE : width / 3;
+    for (int attempt = 0; attempt < FLOOR_ROOM_ATTEMPTS && layout->roomCount < targetRooms; attempt++) {
+        FloorRoom room;
+        room.width = RngRange(&rng, FLOOR_ROOM_MIN_SIZE, maxRoomSize);
+        room.height = RngRange(&rng, FLOOR_ROOM_MIN_SIZE, maxRoomSize);
+        room.x = RngRange(&rng, 1, width - room.width - 1);
+        room.y = RngRange(&rng, 1, height - room.height - 1);
+        if (!FloorRoomOverlaps(layout, &room)) {
+            layout->rooms[layout->roomCount++] = room;
+            FloorCarve(tiles, width, room.x, room.y, room.width, room.height);
+        }
+    }
+    if (layout->roomCount == 0) {
+        FloorRoom room = {width / 4, height / 4, width / 2, height / 2};
+        layout->rooms[layout->roomCount++] = room;
+        FloorCarve(tiles, width, room.x, room.y, room.width, room.height);
+    }
+
+    /* Each room joins the one before it, an L between their centers */
+    for (int i = 1; i < layout->roomCount; i++) {
+        const FloorRoom* a = &layout->rooms[i - 1];
+        const FloorRoom* b = &layout->rooms[i];
+        int ax = a->x + a->width / 2;
+        int ay = a->y + a->height / 2;
+        int bx = b->x + b->width / 2;
+        int by = b->y + b->height / 2;
+        int minX = ax < bx ? ax : bx;
+        int minY = ay < by ? ay : by;
+        int maxX = ax < bx ? bx : ax;
+        int maxY = ay < by ? by : ay;
+        if (RngBelow(&rng, 2)) {
+            FloorCarve(tiles, width, minX, ay, maxX - minX + 1, 1);
+            FloorCarve(tiles, width, bx, minY, 1, maxY - minY + 1);
+        } else {
+            FloorCarve(tiles, width, ax, minY, 1, maxY - minY + 1);
+            FloorCarve(tiles, width, minX, by, maxX - minX + 1, 1);
+        }
+    }
+
+    /* Torches on the walls around rooms, only walls something can see */
+    for (int i = 0; i < layout->roomCount; i++) {
+        const FloorRoom* room = &layout->rooms[i];
+        for (int y = room->y - 1; y <= room->y + room->height; y++) {
+            for (int x = room->x - 1; x <= room->x + room->width; x++) {
+                bool edge = y == room->y - 1 || y == room->y + room->height ||
+                    x == room->x - 1 || x == room->x + room->width;
+                bool corner = (y == room->y - 1 || y == room->y + room->height) &&
+                    (x == room->x - 1 || x == room->x + room->width);
+                if (edge && !corner && tiles[y * width + x] == FLOOR_TILE_WALL && RngBelow(&rng, FLOOR_TORCH_ODDS) == 0) {
+                    tiles[y * width + x] = FLOOR_TILE_TORCH;
+                }
+            }
+        }
+    }
+
+    /* Start in the first room, stairs in the room whose center is furthest from it */
+    const FloorRoom* first = &layout->rooms[0];
+    layout->startX = first->x + first->width / 2;
+    layout->startY = first->y + first->height / 2;
+    int furthest = 0;
+    int furthestDistance = -1;
+    for (int i = 0; i < layout->roomCount; i++) {
+        int dx = layout->rooms[i].x + layout->rooms[i].width / 2 - layout->startX;
+        int dy = layout->rooms[i].y + layout->rooms[i].height / 2 - layout->startY;
+        if (dx * dx + dy * dy > furthestDistance) {
+            furthestDistance = dx * dx + dy * dy;
+            furthest = i;
+        }
+    }
+    const FloorRoom* last = &layout->rooms[furthest];
+    layout->stairsX = last->x + last->width / 2;
+    layout->stairsY = last->y + last->height / 2;
+    if (layout->stairsX == layout->startX && layout->stairsY == layout->startY) {
+        layout->stairsX = last->x;
+        layout->stairsY = last->y;
+    }
+    tiles[layout->stairsY * width + layout->stairsX] = FLOOR_TILE_STAIRS;
+}
+
+/* JobFunction for a FloorJob */
+static void
+FloorGenerateJob(void* data)
+{
+    FloorJob* job = (FloorJob*)data;
+    FloorGenerate(job->tiles, &job->layout, job->width, job->height, job->seed);
+}
+
+#endif
@@ -0,0 +1,211 @@
+#ifndef HASHMAP_H
+#define HASHMAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+  Open addressing hash map from 64 bit keys to 32 bit values, linear probing.
+  Keys and values are separate arrays so a probe only walks the keys.
+  Memory is handed in by the caller (an arena), capacity must be a power of two
+  and the map should stay under ~70% full. Key 0 marks an empty slot, HashKey
+  never returns it.
+
+  SortedIndex is the ordered counterpart: sorted keys with binary search, for
+  lookups that need ranges or ordered iteration.
+*/
+typedef struct HashMap
+{
+    uint64_t* keys;
+    uint32_t* values;
+    size_t capacity;
+    size_t count;
+} HashMap;
+
+typedef struct SortedIndex
+{
+    uint64_t* keys;
+    uint32_t* values;
+    size_t capacity;
+    size_t count;
+} SortedIndex;
+
+#define HASHMAP_EMPTY_KEY 0
+#define HASHMAP_NOT_FOUND 0xffffffffu
+
+/* Usage */
+// HashMap m; HashMapInit(&m, ArenaPush(&arena, HashMapMemorySize(64), 16), 64);
+// HashMapPut(&m, HashKey(id), value); uint32_t v = HashMapGet(&m, HashKey(id));
+
+#define HashMapMemorySize(cap)      ((sizeof(uint64_t) + sizeof(uint32_t)) * (cap))
+#define SortedIndexMemorySize(cap)  ((sizeof(uint64_t) + sizeof(uint32_t)) * (cap))
+
+/* splitmix64 finalizer */
+static inline uint64_t
+HashMix64(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+static inline uint64_t
+HashKey(uint64_t id)
+{
+    uint64_t key = HashMix64(id);
+    return key == HASHMAP_EMPTY_KEY ? 1 : key;
+}
+
+/*
+  Key for a multiset of ids, the same ids in any order give the same key and
+  repeating an id changes it. Sums of mixed ids so it can also be built up one
+  id at a time.
+*/
+static inline uint64_t
+HashMultiset(const int* ids, size_t count)
+{
+    uint64_t key = 0;
+    for (size_t i = 0; i < count; i++) {
+        key += HashMix64((uint64_t)ids[i] + 0x9e3779b97f4a7c15ull);
+    }
+    key = HashMix64(key ^ count);
+    return key == HASHMAP_EMPTY_KEY ? 1 : key;
+}
+
+static void
+HashMapInit(HashMap* map, void* memory, size_t capacity)
+{
+    map->keys = (uint64_t*)memory;
+    map->values = (uint32_t*)(map->keys + capacity);
+    map->capacity = capacity;
+    map->count = 0;
+    memset(map->keys, 0, sizeof(uint64_t) * capacity);
+}
+
+/* 0 when the map is full */
+static int
+HashMapPut(HashMap* map, uint64_t key, uint32_t value)
+{
+    size_t mask = map->capacity - 1;
+    for (size_t i = key & mask, probes = 0; probes < map->capacity; i = (i + 1) & mask, probes++) {
+        if (map->keys[i] == key) {
+            map->values[i] = value;
+            return 1;
+        }
+        if (map->keys[i] == HASHMAP_EMPTY_KEY) {
+            map->keys[i] = key;
+            map->values[i] = value;
+            map->count++;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static uint32_t
+HashMapGet(const HashMap* map, uint64_t key)
+{
+    size_t mask = map->capacity - 1;
+    for (size_t i = key & mask, probes = 0; probes < map->capacity; i = (i + 1) & mask, probes++) {
+        if (map->keys[i] == key) {
+            return map->values[i];
+        }
+        if (map->keys[i] == HASHMAP_EMPTY_KEY) {
+            break;
+        }
+    }
+    return HASHMAP_NOT_FOUND;
+}
+
+/* Backward shift delete, no tombstones so probes stay short */
+static int
+HashMapRemove(HashMap* map, uint64_t key)
+{
+    size_t mask = map->capacity - 1;
+    size_t i = key & mask;
+    size_t probes = 0;
+    while (map->keys[i] != key) {
+        if (map->keys[i] == HASHMAP_EMPTY_KEY || ++probes == map->capacity) {
+            return 0;
+        }
+        i = (i + 1) & mask;
+    }
+
+    size_t hole = i;
+    for (size_t j = (hole + 1) & mask; map->keys[j] != HASHMAP_EMPTY_KEY; j = (j + 1) & mask) {
+        /* an entry can fill the hole if the hole is between its home slot and j */
+        size_t home = map->keys[j] & mask;
+        if (((j - home) & mask) >= ((j - hole) & mask)) {
+            map->keys[hole] = map->keys[j];
+            map->values[hole] = map->values[j];
+            hole = j;
+        }
+    }
+    map->keys[hole] = HASHMAP_EMPTY_KEY;
+    map->count--;
+    return 1;
+}
+
+static void
+SortedIndexInit(SortedIndex* index, void* memory, size_t capacity)
+{
+    index->keys = (uint64_t*)memory;
+    index->values = (uint32_t*)(index->keys + capacity);
+    index->capacity = capacity;
+    index->count = 0;
+}
+
+/* First position whose key is >= key */
+static size_t
+SortedIndexLowerBound(const SortedIndex* index, uint64_t key)
+{
+    size_t low = 0;
+    size_t high = index->count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (index->keys[middle] < key) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+/* Duplicate keys are allowed, they stay in insertion order. 0 when full */
+static int
+SortedIndexInsert(SortedIndex* index, uint64_t key, uint32_t value)
+{
+    if (index->count == index->capacity) {
+        return 0;
+    }
+    size_t at = SortedIndexLowerBound(index, key + 1);
+    if (key == UINT64_MAX) {
+        at = index->count;
+    }
+    memmove(&index->keys[at + 1], &index->keys[at], sizeof(uint64_t) * (index->count - at));
+    memmove(&index->values[at + 1], &index->values[at], sizeof(uint32_t) * (index->count - at));
+    index->keys[at] = key;
+    index->values[at] = value;
+    index->count++;
+    return 1;
+}
+
+/* Number of entries with this key, *first is the position of the first one */
+static size_t
+SortedIndexFind(const SortedIndex* index, uint64_t key, size_t* first)
+{
+    size_t at = SortedIndexLowerBound(index, key);
+    size_t end = at;
+    while (end < index->count && index->keys[end] == key) {
+        end++;
+    }
+    *first = at;
+    return end - at;
+}
+
+#endif
@@ -0,0 +1,307 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+
+#if (defined(PLATFORM_WEB) && !defined(__EMSCRIPTEN_PTHREADS__)) || defined(JOBS_NO_THREADS)
+#define JOB_THREADS 0
+#else
+#define JOB_THREADS 1
+#include <pthread.h>
+#endif
+
+/*
+  Job system, a few worker threads for work that would otherwise stall a frame.
+  A job is a function and its data, started from the main thread with a
+  counter the main thread polls (JobDone) or waits on (JobWait).
+
+  Every worker has its own deque. Jobs are handed out round robin to the
+  bottom of the deques, a worker takes its newest job from the bottom and
+  when it runs dry steals the oldest from the top of someone else's.
+  JobWait doesn't just sleep, the main thread steals and runs jobs too.
+
+  Without threads (web build without -pthread, JOBS_NO_THREADS, or no
+  worker could start) JobRun runs the job before it returns.
+  Jobs must not touch the arenas, raylib's GPU side or start other jobs.
+  On the web a worker's file reads are proxied to the main thread, poll
+  those jobs instead of waiting on them.
+*/
+#define JOB_MAX_THREADS 8
+#define JOB_QUEUE_SIZE 64       // jobs per deque, a full deque runs the job inline
+
+typedef void (*JobFunction)(void* data);
+
+/* Jobs started with it still to finish, zero it before the first JobRun */
+typedef struct JobCounter
+{
+    int pending;
+} JobCounter;
+
+typedef struct Job
+{
+    JobFunction function;
+    void* data;
+    JobCounter* counter;
+} Job;
+
+typedef struct JobQueue
+{
+    Job jobs[JOB_QUEUE_SIZE];
+    unsigned int top;       // thieves take from here
+    unsigned int bottom;    // the owner pushes and pops here
+#if JOB_THREADS
+    pthread_mutex_t mutex;
+#endif
+} JobQueue;
+
+struct JobSystem;
+
+typedef struct JobWorker
+{
+    struct JobSystem* system;
+    int index;              // its queue
+#if JOB_THREADS
+    pthread_t thread;
+#endif
+} JobWorker;
+
+typedef struct JobSystem
+{
+    JobQueue queues[JOB_MAX_THREADS];
+    JobWorker workers[JOB_MAX_THREADS];
+    int threadCount;        // queues in use, 0 when jobs run inline
+    int running;            // workers that started, a queue without one is only stolen from
+    unsigned int next;      // queue the next job goes to
+    int queued;             // jobs in the queues, workers sleep when it's 0
+    bool quit;
+#if JOB_THREADS
+    pthread_mutex_t mutex;  // counters, queued and quit
+    pthread_cond_t wake;    // a job was queued, or quit
+    pthread_cond_t done;    // a counter reached zero
+#endif
+} JobSystem;
+
+/* Usage */
+// JobSystem jobs; JobSystemStart(&jobs, 3);
+// JobCounter counter = {0}; JobRun(&jobs, Work, &data, &counter);
+// if (JobDone(&jobs, &counter)) ... or JobWait(&jobs, &counter);
+// JobSystemStop(&jobs);
+
+static void
+JobLock(JobSystem* system)
+{
+#if JOB_THREADS
+    pthread_mutex_lock(&system->mutex);
+#else
+    (void)system;
+#endif
+}
+
+static void
+JobUnlock(JobSystem* system)
+{
+#if JOB_THREADS
+    pthread_mutex_unlock(&system->mutex);
+#else
+    (void)system;
+#endif
+}
+
+static void
+JobFinish(JobSystem* system, JobCounter* counter)
+{
+    JobLock(system);
+    if (--counter->pending == 0) {
+#if JOB_THREADS
+        pthread_cond_broadcast(&system->done);
+#endif
+    }
+    JobUnlock(system);
+}
+
+#if JOB_THREADS
+/* Newest job of queue index, or the oldest of any other queue. self is -1 for the main thread */
+static bool
+JobTake(JobSystem* system, int self, Job* job)
+{
+    bool found = false;
+    if (self >= 0) {
+        JobQueue* queue = &system->queues[self];
+        pthread_mutex_lock(&queue->mutex);
+        if (queue->bottom != queue->top) {
+            *job = queue->jobs[--queue->bottom % JOB_QUEUE_SIZE];
+            found = true;
+        }
+        pthread_mutex_unlock(&queue->mutex);
+    }
+    for (int i = 1; i <= system->threadCount && !found; i++) {
+        JobQueue* queue = &system->queues[(self + i + system->threadCount) % system->threadCount];
+        pthread_mutex_lock(&queue->mutex);
+        if (queue->bottom != queue->top) {
+            *job = queue->jobs[queue->top++ % JOB_QUEUE_SIZE];
+            found = true;
+        }
+        pthread_mutex_unlock(&queue->mutex);
+    }
+    if (found) {
+        pthread_mutex_lock(&system->mutex);
+        system->queued--;
+        pthread_mutex_unlock(&system->mutex);
+    }
+    return found;
+}
+
+static void*
+JobWorkerMain(void* data)
+{
+    JobWorker* worker = (JobWorker*)data;
+    JobSystem* system = worker->system;
+    for (;;) {
+        Job job;
+        if (JobTake(system, worker->index, &job)) {
+            job.function(job.data);
+            JobFinish(system, job.counter);
+            continue;
+        }
+        pthread_mutex_lock(&system->mutex);
+        while (system->queued == 0 && !system->quit) {
+            pthread_cond_wait(&system->wake, &system->mutex);
+        }
+        bool quit = system->quit && system->queued == 0;
+        pthread_mutex_unlock(&system->mutex);
+        if (quit) {
+            return NULL;
+        }
+    }
+}
+#endif
+
+/* threadCount workers, at most JOB_MAX_THREADS. Returns how many started, 0 means inline */
+static int
+JobSystemStart(JobSystem* system, int threadCount)
+{
+    memset(system, 0, sizeof(JobSystem));
+#if JOB_THREADS
+    threadCount = threadCount < JOB_MAX_THREADS ? threadCount : JOB_MAX_THREADS;
+    pthread_mutex_init(&system->mutex, NULL);
+    pthread_cond_init(&system->wake, NULL);
+    pthread_cond_init(&system->done, NULL);
+    for (int i = 0; i < JOB_MAX_THREADS; i++) {
+        pthread_mutex_init(&system->queues[i].mutex, NULL);
+    }
+    /* Workers look at threadCount queues, it's set before the first one starts and never changes */
+    system->threadCount = threadCount > 0 ? threadCount : 0;
+    for (int i = 0; i < system->threadCount; i++) {
+        system->workers[i].system = system;
+        system->workers[i].index = i;
+        if (pthread_create(&system->workers[i].thread, NULL, JobWorkerMain, &system->workers[i]) != 0) {
+            printf("Started %d of %d job threads.\n", system->running, system->threadCount);
+            break;
+        }
+        system->running++;
+    }
+    if (system->running == 0) {
+        system->threadCount = 0;
+    }
+    return system->running;
+#else
+    (void)threadCount;
+    return 0;
+#endif
+}
+
+/* Starts function(data) on a worker, counter stays above zero until it has run */
+static void
+JobRun(JobSystem* system, JobFunction function, void* data, JobCounter* counter)
+{
+    JobLock(system);
+    counter->pending++;
+    JobUnlock(system);
+
+#if JOB_THREADS
+    if (system->threadCount > 0) {
+        JobQueue* queue = &system->queues[system->next++ % (unsigned int)system->threadCount];
+        pthread_mutex_lock(&queue->mutex);
+        bool full = queue->bottom - queue->top == JOB_QUEUE_SIZE;
+        if (!full) {
+            /* Counted before the queue lets go of it, queued never drops below what's there */
+            queue->jobs[queue->bottom++ % JOB_QUEUE_SIZE] = (Job){function, data, counter};
+            pthread_mutex_lock(&system->mutex);
+            system->queued++;
+            pthread_cond_signal(&system->wake);
+            pthread_mutex_unlock(&system->mutex);
+        }
+        pthread_mutex_unlock(&queue->mutex);
+        if (!full) {
+            return;
+        }
+    }
+#endif
+    function(data);
+    JobFinish(system, counter);
+}
+
+/* Without blocking, true once every job started with counter has run */
+static bool
+JobDone(JobSystem* system, JobCounter* counter)
+{
+    JobLock(system);
+    bool done = counter->pending == 0;
+    JobUnlock(system);
+    return done;
+}
+
+/* Runs queued jobs on this thread until every job started with counter has run */
+static void
+JobWait(JobSystem* system, JobCounter* counter)
+{
+#if JOB_THREADS
+    for (;;) {
+        Job job;
+        if (JobDone(system, counter)) {
+            return;
+        }
+        if (JobTake(system, -1, &job)) {
+            job.function(job.data);
+            JobFinish(system, job.counter);
+            continue;
+        }
+        /* Nothing left to steal, what's left is running on the workers */
+        pthread_mutex_lock(&system->mutex);
+        while (counter->pending > 0 && system->queued == 0) {
+            pthread_cond_wait(&system->done, &system->mutex);
+        }
+        pthread_mutex_unlock(&system->mutex);
+    }
+#else
+    (void)system;
+    (void)counter;
+#endif
+}
+
+/* Runs out every queued job, then joins the workers */
+static void
+JobSystemStop(JobSystem* system)
+{
+#if JOB_THREADS
+    pthread_mutex_lock(&system->mutex);
+    system->quit = true;
+    pthread_cond_broadcast(&system->wake);
+    pthread_mutex_unlock(&system->mutex);
+    for (int i = 0; i < system->running; i++) {
+        pthread_join(system->workers[i].thread, NULL);
+    }
+    for (int i = 0; i < JOB_MAX_THREADS; i++) {
+        pthread_mutex_destroy(&system->queues[i].mutex);
+    }
+    pthread_mutex_destroy(&system->mutex);
+    pthread_cond_destroy(&system->wake);
+    pthread_cond_destroy(&system->done);
+#endif
+    system->threadCount = 0;
+    system->running = 0;
+}
+
+#endif
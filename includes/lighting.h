@@ -0,0 +1,425 @@
+#ifndef LIGHTING_H
+#define LIGHTING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include "../raylibIncludes/raylib.h"
+
+/*
+  Tile light and field of view with recursive shadowcasting (8 octants).
+
+  Every light keeps what it lit in its own grid around it, cast again only
+  when the light moves or a tile it reaches turns opaque or clear. The map's
+  brightness per tile is the brightest light on it, rebuilt only for the
+  LIGHT_CHUNK_SIZE squares that a dirty light's old or new reach touches,
+  and only those squares go to the texture (UpdateTextureRec).
+
+  One light can be the viewer, tiles it doesn't see are unexplored (black)
+  or remembered (dim). Without a viewer everything is visible.
+
+  The texture has one texel per tile (grayscale), drawn over the map
+  stretched to tile size with BLEND_MULTIPLIED and bilinear filtering.
+*/
+#define LIGHT_MAX_LIGHTS 256
+#define LIGHT_MAX_RADIUS 16
+#define LIGHT_GRID_SIZE (2 * LIGHT_MAX_RADIUS + 1)
+#define LIGHT_CHUNK_SIZE 16         // tiles per dirty square on each axis
+#define LIGHT_DEFAULT_AMBIENT 48    // visible but no light on it
+#define LIGHT_DEFAULT_REMEMBERED 24 // explored, out of view
+#define LIGHT_NONE -1
+
+typedef struct Light
+{
+    int x;
+    int y;
+    int radius;         // tiles, up to LIGHT_MAX_RADIUS
+    uint8_t intensity;  // on the light's own tile, falls off to 0 just past radius
+    bool active;
+    bool dirty;         // grid has to be cast again
+    uint8_t* grid;      // LIGHT_GRID_SIZE squared, centered on the light
+} Light;
+
+typedef struct LightMap
+{
+    int width;
+    int height;
+    uint8_t* opaque;    // per tile, blocks light and sight
+    uint8_t* explored;  // per tile, the viewer has seen it
+    uint8_t* texels;    // per tile, what the texture holds
+    uint8_t* chunkDirty;
+    int chunkCountX;
+    int chunkCountY;
+
+    Light lights[LIGHT_MAX_LIGHTS];
+    int lightCount;     // slots used so far, removed lights leave inactive slots
+    int viewer;         // LIGHT_NONE when everything is visible
+    uint8_t ambient;
+    uint8_t remembered;
+
+    Texture2D texture;  // id 0 until LightMapLoadTexture, updates skip the upload
+    uint8_t upload[LIGHT_CHUNK_SIZE * LIGHT_CHUNK_SIZE];
+
+    /* last LightMapUpdate */
+    int castCount;
+    int chunkCount;
+} LightMap;
+
+/* Usage */
+// LightMap l; LightMapInit(&l, ArenaPush(&arena, LightMapMemorySize(w, h), 16), w, h); LightMapLoadTexture(&l);
+// int torch = LightMapAddLight(&l, 3, 4, 6, 220); LightMapSetOpaque(&l, 5, 4, true);
+// LightMapMoveLight(&l, torch, 4, 4); LightMapUpdate(&l); LightMapDraw(&l, tileSize);
+
+#define LightMapMemorySize(width, height) \
+    ((size_t)(width) * (height) * 3 + \
+     (size_t)(((width) + LIGHT_CHUNK_SIZE - 1) / LIGHT_CHUNK_SIZE) * (((height) + LIGHT_CHUNK_SIZE - 1) / LIGHT_CHUNK_SIZE) + \
+     (size_t)LIGHT_MAX_LIGHTS * LIGHT_GRID_SIZE * LIGHT_GRID_SIZE)
+
+static void
+LightMapInit(LightMap* map, void* memory, int width, int height)
+{
+    memset(map, 0, sizeof(LightMap));
+    map->width = width;
+    map->height = height;
+    map->chunkCountX = (width + LIGHT_CHUNK_SIZE - 1) / LIGHT_CHUNK_SIZE;
+    map->chunkCountY = (height + LIGHT_CHUNK_SIZE - 1) / LIGHT_CHUNK_SIZE;
+    map->viewer = LIGHT_NONE;
+    map->ambient = LIGHT_DEFAULT_AMBIENT;
+    map->remembered = LIGHT_DEFAULT_REMEMBERED;
+
+    size_t tileCount = (size_t)width * height;
+    size_t chunkCount = (size_t)map->chunkCountX * map->chunkCountY;
+    uint8_t* next = (uint8_t*)memory;
+    map->opaque = next;
+    next += tileCount;
+    map->explored = next;
+    next += tileCount;
+    map->texels = next;
+    next += tileCount;
+    map->chunkDirty = next;
+    next += chunkCount;
+    for (int i = 0; i < LIGHT_MAX_LIGHTS; i++) {
+        map->lights[i].grid = next + (size_t)i * LIGHT_GRID_SIZE * LIGHT_GRID_SIZE;
+    }
+    memset(memory, 0, tileCount * 3);
+
+    /* Nothing is built yet, the first update does the whole map */
+    memset(map->chunkDirty, 1, chunkCount);
+}
+
+/* Texture the size of the map in tiles, needs a window (GPU) */
+static void
+LightMapLoadTexture(LightMap* map)
+{
+    Image image = {map->texels, map->width, map->height, 1, PIXELFORMAT_UNCOMPRESSED_GRAYSCALE};
+    map->texture = LoadTextureFromImage(image);
+    SetTextureFilter(map->texture, TEXTURE_FILTER_BILINEAR);
+}
+
+static void
+LightMapUnload(LightMap* map)
+{
+    if (map->texture.id != 0) {
+        UnloadTexture(map->texture);
+    }
+    memset(&map->texture, 0, sizeof(Texture2D));
+}
+
+/* Squares covering the light's reach are rebuilt on the next update */
+static void
+LightMapMarkReach(LightMap* map, const Light* light)
+{
+    int minX = (light->x - light->radius) / LIGHT_CHUNK_SIZE;
+    int minY = (light->y - light->radius) / LIGHT_CHUNK_SIZE;
+    int maxX = (light->x + light->radius) / LIGHT_CHUNK_SIZE;
+    int maxY = (light->y + light->radius) / LIGHT_CHUNK_SIZE;
+    minX = minX < 0 ? 0 : minX;
+    minY = minY < 0 ? 0 : minY;
+    maxX = maxX >= map->chunkCountX ? map->chunkCountX - 1 : maxX;
+    maxY = maxY >= map->chunkCountY ? map->chunkCountY - 1 : maxY;
+    for (int y = minY; y <= maxY; y++) {
+        memset(map->chunkDirty + y * map->chunkCountX + minX, 1, (size_t)(maxX - minX + 1));
+    }
+}
+
+/* Light index, LIGHT_NONE when every slot is used */
+static int
+LightMapAddLight(LightMap* map, int x, int y, int radius, uint8_t intensity)
+{
+    int index = LIGHT_NONE;
+    for (int i = 0; i < map->lightCount && index == LIGHT_NONE; i++) {
+        if (!map->lights[i].active) {
+            index = i;
+        }
+    }
+    if (index == LIGHT_NONE) {
+        if (map->lightCount == LIGHT_MAX_LIGHTS) {
+            return LIGHT_NONE;
+        }
+        index = map->lightCount++;
+    }
+
+    Light* light = &map->lights[index];
+    light->x = x;
+    light->y = y;
+    light->radius = radius < 0 ? 0 : radius > LIGHT_MAX_RADIUS ? LIGHT_MAX_RADIUS : radius;
+    light->intensity = intensity;
+    light->active = true;
+    light->dirty = true;
+    return index;
+}
+
+static void
+LightMapRemoveLight(LightMap* map, int index)
+{
+    if (index < 0 || index >= map->lightCount || !map->lights[index].active) {
+        return;
+    }
+    map->lights[index].active = false;
+    LightMapMarkReach(map, &map->lights[index]);
+    if (map->viewer == index) {
+        map->viewer = LIGHT_NONE;
+        memset(map->chunkDirty, 1, (size_t)map->chunkCountX * map->chunkCountY);
+    }
+}
+
+/* Nothing is cast again unless the light changed tile */
+static void
+LightMapMoveLight(LightMap* map, int index, int x, int y)
+{
+    if (index < 0 || index >= map->lightCount) {
+        return;
+    }
+    Light* light = &map->lights[index];
+    if (!light->active || (light->x == x && light->y == y)) {
+        return;
+    }
+    LightMapMarkReach(map, light);
+    light->x = x;
+    light->y = y;
+    light->dirty = true;
+}
+
+/* What the whole map shows depends on the viewer, every square is rebuilt */
+static void
+LightMapSetViewer(LightMap* map, int index)
+{
+    map->viewer = index;
+    memset(map->chunkDirty, 1, (size_t)map->chunkCountX * map->chunkCountY);
+}
+
+/* Only the lights that reach the tile are cast again */
+static void
+LightMapSetOpaque(LightMap* map, int x, int y, bool opaque)
+{
+    uint8_t* tile = &map->opaque[y * map->width + x];
+    if (*tile == (uint8_t)opaque) {
+        return;
+    }
+    *tile = (uint8_t)opaque;
+    for (int i = 0; i < map->lightCount; i++) {
+        Light* light = &map->lights[i];
+        if (light->active && abs(light->x - x) <= light->radius && abs(light->y - y) <= light->radius) {
+            light->dirty = true;
+        }
+    }
+}
+
+static bool
+LightMapBlocks(const LightMap* map, int x, int y)
+{
+    if (x < 0 || y < 0 || x >= map->width || y >= map->height) {
+        return true;
+    }
+    return map->opaque[y * map->width + x] != 0;
+}
+
+/* dx, dy from the light, falls off linearly with distance */
+static void
+LightMapLight(Light* light, int dx, int dy)
+{
+    float distance = sqrtf((float)(dx * dx + dy * dy));
+    float brightness = light->intensity * (1.f - distance / (light->radius + 1.f));
+    light->grid[(dy + LIGHT_MAX_RADIUS) * LIGHT_GRID_SIZE + dx + LIGHT_MAX_RADIUS] = (uint8_t)brightness;
+}
+
+/*
+  One octant, rows outwards from the light. A run of opaque tiles narrows
+  the slopes still lit, the part of the row before it goes on in a recursion.
+  xx, xy, yx, yy turn the octant's (column, row) into map offsets
+*/
+static void
+LightMapCastOctant(const LightMap* map, Light* light, int row, float startSlope, float endSlope,
+                   int xx, int xy, int yx, int yy)
+{
+    if (startSlope < endSlope) {
+        return;
+    }
+    int radiusSquared = light->radius * light->radius;
+    float nextStartSlope = startSlope;
+    for (int distance = row; distance <= light->radius; distance++) {
+        bool blocked = false;
+        int dy = -distance;
+        for (int dx = -distance; dx <= 0; dx++) {
+            float leftSlope = (dx - 0.5f) / (dy + 0.5f);
+            float rightSlope = (dx + 0.5f) / (dy - 0.5f);
+            if (startSlope < rightSlope) {
+                continue;
+            }
+            if (endSlope > leftSlope) {
+                break;
+            }
+
+            int offsetX = dx * xx + dy * xy;
+            int offsetY = dx * yx + dy * yy;
+            int x = light->x + offsetX;
+            int y = light->y + offsetY;
+            bool inside = x >= 0 && y >= 0 && x < map->width && y < map->height;
+            if (inside && dx * dx + dy * dy <= radiusSquared) {
+                LightMapLight(light, offsetX, offsetY);
+            }
+
+            bool opaque = LightMapBlocks(map, x, y);
+            if (blocked) {
+                if (opaque) {
+                    nextStartSlope = rightSlope;
+                    continue;
+                }
+                blocked = false;
+                startSlope = nextStartSlope;
+            } else if (opaque && distance < light->radius) {
+                blocked = true;
+                LightMapCastOctant(map, light, distance + 1, startSlope, leftSlope, xx, xy, yx, yy);
+                nextStartSlope = rightSlope;
+            }
+        }
+        if (blocked) {
+            break;
+        }
+    }
+}
+
+static void
+LightMapCast(const LightMap* map, Light* light)
+{
+    static const int octants[4][8] = {
+        {1, 0, 0, -1, -1, 0, 0, 1},
+        {0, 1, -1, 0, 0, -1, 1, 0},
+        {0, 1, 1, 0, 0, -1, -1, 0},
+        {1, 0, 0, 1, -1, 0, 0, -1},
+    };
+    memset(light->grid, 0, LIGHT_GRID_SIZE * LIGHT_GRID_SIZE);
+    if (light->x < 0 || light->y < 0 || light->x >= map->width || light->y >= map->height) {
+        return;
+    }
+    LightMapLight(light, 0, 0);
+    for (int octant = 0; octant < 8; octant++) {
+        LightMapCastOctant(map, light, 1, 1.f, 0.f,
+                           octants[0][octant], octants[1][octant], octants[2][octant], octants[3][octant]);
+    }
+}
+
+/* Brightest light per tile, then what the viewer sees of it, into texels and upload */
+static void
+LightMapBuildChunk(LightMap* map, int chunkX, int chunkY)
+{
+    int minX = chunkX * LIGHT_CHUNK_SIZE;
+    int minY = chunkY * LIGHT_CHUNK_SIZE;
+    int maxX = minX + LIGHT_CHUNK_SIZE > map->width ? map->width : minX + LIGHT_CHUNK_SIZE;
+    int maxY = minY + LIGHT_CHUNK_SIZE > map->height ? map->height : minY + LIGHT_CHUNK_SIZE;
+    int width = maxX - minX;
+    uint8_t* lit = map->upload;
+    memset(lit, 0, sizeof(map->upload));
+
+    for (int i = 0; i < map->lightCount; i++) {
+        const Light* light = &map->lights[i];
+        if (!light->active) {
+            continue;
+        }
+        int x0 = light->x - light->radius > minX ? light->x - light->radius : minX;
+        int y0 = light->y - light->radius > minY ? light->y - light->radius : minY;
+        int x1 = light->x + light->radius + 1 < maxX ? light->x + light->radius + 1 : maxX;
+        int y1 = light->y + light->radius + 1 < maxY ? light->y + light->radius + 1 : maxY;
+        for (int y = y0; y < y1; y++) {
+            const uint8_t* row = light->grid + (y - light->y + LIGHT_MAX_RADIUS) * LIGHT_GRID_SIZE +
+                (x0 - light->x + LIGHT_MAX_RADIUS);
+            uint8_t* out = lit + (y - minY) * width + (x0 - minX);
+            for (int x = 0; x < x1 - x0; x++) {
+                out[x] = row[x] > out[x] ? row[x] : out[x];
+            }
+        }
+    }
+
+    const Light* viewer = map->viewer == LIGHT_NONE ? NULL : &map->lights[map->viewer];
+    for (int y = minY; y < maxY; y++) {
+        for (int x = minX; x < maxX; x++) {
+            int tile = y * map->width + x;
+            uint8_t* texel = &lit[(y - minY) * width + x - minX];
+            bool visible = true;
+            if (viewer) {
+                int dx = x - viewer->x;
+                int dy = y - viewer->y;
+                visible = abs(dx) <= viewer->radius && abs(dy) <= viewer->radius &&
+                    viewer->grid[(dy + LIGHT_MAX_RADIUS) * LIGHT_GRID_SIZE + dx + LIGHT_MAX_RADIUS] != 0;
+            }
+            if (visible) {
+                map->explored[tile] = 1;
+                *texel = *texel > map->ambient ? *texel : map->ambient;
+            } else {
+                *texel = map->explored[tile] ? map->remembered : 0;
+            }
+            map->texels[tile] = *texel;
+        }
+    }
+
+    if (map->texture.id != 0) {
+        UpdateTextureRec(map->texture, (Rectangle){(float)minX, (float)minY, (float)width, (float)(maxY - minY)}, lit);
+    }
+}
+
+/* Casts the dirty lights, rebuilds and uploads the squares they touch */
+static void
+LightMapUpdate(LightMap* map)
+{
+    map->castCount = 0;
+    map->chunkCount = 0;
+    for (int i = 0; i < map->lightCount; i++) {
+        Light* light = &map->lights[i];
+        if (light->active && light->dirty) {
+            LightMapCast(map, light);
+            LightMapMarkReach(map, light);
+            light->dirty = false;
+            map->castCount++;
+        }
+    }
+
+    for (int y = 0; y < map->chunkCountY; y++) {
+        for (int x = 0; x < map->chunkCountX; x++) {
+            uint8_t* dirty = &map->chunkDirty[y * map->chunkCountX + x];
+            if (*dirty) {
+                LightMapBuildChunk(map, x, y);
+                *dirty = 0;
+                map->chunkCount++;
+            }
+        }
+    }
+}
+
+/* Over the map in world space (inside BeginMode2D), darkens what's already drawn */
+static void
+LightMapDraw(const LightMap* map, Vector2 tileSize)
+{
+    if (map->texture.id == 0) {
+        return;
+    }
+    BeginBlendMode(BLEND_MULTIPLIED);
+    DrawTexturePro(map->texture, (Rectangle){0.f, 0.f, (float)map->width, (float)map->height},
+                   (Rectangle){0.f, 0.f, map->width * tileSize.x, map->height * tileSize.y},
+                   (Vector2){0.f, 0.f}, 0.f, WHITE);
+    EndBlendMode();
+}
+
+#endif
@@ -0,0 +1,514 @@
+#ifndef PATHFINDING_H
+#define PATHFINDING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+  Tile grid pathfinding, 8 directions, no cutting corners past blocked tiles.
+  Costs are whole numbers, 10 straight and 14 diagonal.
+
+  A PathGrid owns every array a search needs, sized once for the map, so a
+  query allocates nothing. Instead of clearing them per query each tile has a
+  stamp, a tile whose stamp isn't this query's is untouched. The open list is
+  a binary heap indexed by tile so a cheaper way to a tile already on it
+  moves it up instead of adding a duplicate.
+
+  PATH_SEARCH_JUMP is jump point search: it only puts tiles where the path
+  could turn on the open list and jumps over the straight runs in between,
+  big open floors expand a fraction of the tiles A* does. Paths come out the
+  same length either way, it's filled in tile by tile.
+
+  Flow fields answer "which way to the target" for every tile within a radius
+  of it, one Dijkstra from the target shared by everything heading there.
+  PathFlowCache keeps the last few targets, a grid change makes them rebuild.
+*/
+#define PATH_COST_STRAIGHT 10
+#define PATH_COST_DIAGONAL 14
+#define PATH_NOT_FOUND -1
+#define PATH_NO_DIRECTION 0xff
+#define PATH_MAX_FLOW_FIELDS 8
+
+typedef enum PathSearch
+{
+    PATH_SEARCH_ASTAR,
+    PATH_SEARCH_JUMP,
+} PathSearch;
+
+/* Direction indices of flow fields, clockwise from +x (y goes down) */
+static const int pathDirections[8][2] = {
+    {1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0}, {-1, -1}, {0, -1}, {1, -1},
+};
+
+typedef struct PathHeapEntry
+{
+    uint32_t score;     // cost so far plus the estimate left
+    uint32_t cost;      // copy of the tile's, comparisons don't have to look it up
+    int32_t tile;
+} PathHeapEntry;
+
+typedef struct PathGrid
+{
+    int width;
+    int height;
+    int tileCount;
+    const uint8_t* blocked; // per tile, not 0 can't be walked on, the caller's
+    uint32_t version;       // PathGridChanged bumps it
+
+    /* per tile, only meaningful where stamp is this query's */
+    uint32_t* cost;
+    int32_t* parent;
+    uint32_t* stamp;        // query when seen, query + 1 once closed
+    int32_t* heapIndex;
+    PathHeapEntry* heap;
+    int heapCount;
+    uint32_t query;         // even, goes up by 2 per search
+
+    int expanded;           // tiles closed by the last search
+} PathGrid;
+
+typedef struct PathFlowField
+{
+    int targetX;            // -1 when the slot is free
+    int targetY;
+    int originX;            // top left of the window, target - radius
+    int originY;
+    uint32_t version;       // grid version it was built from
+    unsigned int lastUsed;
+    uint8_t* directions;    // window, PATH_NO_DIRECTION where the target is out of reach
+} PathFlowField;
+
+typedef struct PathFlowCache
+{
+    PathFlowField fields[PATH_MAX_FLOW_FIELDS];
+    int radius;
+    int size;               // 2 * radius + 1, the window's width and height
+    unsigned int tick;
+    int builds;             // fields built so far
+} PathFlowCache;
+
+/* Usage */
+// PathGrid g; PathGridInit(&g, ArenaPush(&arena, PathGridMemorySize(w * h), 16), w, h, blocked);
+// int tiles[256]; int length = PathFind(&g, 1, 1, 30, 20, tiles, 256, PATH_SEARCH_JUMP);
+// PathFlowCache f; PathFlowCacheInit(&f, ArenaPush(&arena, PathFlowCacheMemorySize(24), 16), 24);
+// const PathFlowField* field = PathFlowFieldFor(&f, &g, 30, 20); int d = PathFlowDirection(&f, field, x, y);
+
+#define PathGridMemorySize(tileCount) ((size_t)(tileCount) * (sizeof(uint32_t) * 2 + sizeof(int32_t) * 2 + sizeof(PathHeapEntry)))
+#define PathFlowCacheMemorySize(radius) ((size_t)PATH_MAX_FLOW_FIELDS * (2 * (radius) + 1) * (2 * (radius) + 1))
+
+static inline void
+PathGridInit(PathGrid* grid, void* memory, int width, int height, const uint8_t* blocked)
+{
+    memset(grid, 0, sizeof(PathGrid));
+    grid->width = width;
+    grid->height = height;
+    grid->tileCount = width * height;
+    grid->blocked = blocked;
+
+    size_t count = (size_t)grid->tileCount;
+    unsigned char* next = (unsigned char*)memory;
+    grid->heap = (PathHeapEntry*)next;
+    next += sizeof(PathHeapEntry) * count;
+    grid->cost = (uint32_t*)next;
+    next += sizeof(uint32_t) * count;
+    grid->stamp = (uint32_t*)next;
+    next += sizeof(uint32_t) * count;
+    grid->parent = (int32_t*)next;
+    next += sizeof(int32_t) * count;
+    grid->heapIndex = (int32_t*)next;
+    memset(grid->stamp, 0, sizeof(uint32_t) * count);
+}
+
+/* Call after changing blocked, cached flow fields are rebuilt when next asked for */
+static inline void
+PathGridChanged(PathGrid* grid)
+{
+    grid->version++;
+}
+
+/* Off the map counts as blocked */
+static inline int
+PathBlocked(const PathGrid* grid, int x, int y)
+{
+    return x < 0 || y < 0 || x >= grid->width || y >= grid->height || grid->blocked[y * grid->width + x];
+}
+
+/* A diagonal step needs both tiles it squeezes between to be open */
+static inline int
+PathCanStep(const PathGrid* grid, int x, int y, int dx, int dy)
+{
+    if (PathBlocked(grid, x + dx, y + dy)) {
+        return 0;
+    }
+    return dx == 0 || dy == 0 || (!PathBlocked(grid, x + dx, y) && !PathBlocked(grid, x, y + dy));
+}
+
+/* Exact cost between two tiles on an empty grid */
+static inline uint32_t
+PathOctile(int dx, int dy)
+{
+    dx = abs(dx);
+    dy = abs(dy);
+    int straight = dx > dy ? dx - dy : dy - dx;
+    int diagonal = dx < dy ? dx : dy;
+    return (uint32_t)(straight * PATH_COST_STRAIGHT + diagonal * PATH_COST_DIAGONAL);
+}
+
+/* Lower score first, on a tie the one further along */
+static inline int
+PathHeapBefore(const PathGrid* grid, PathHeapEntry a, PathHeapEntry b)
+{
+    (void)grid;
+    return a.score < b.score || (a.score == b.score && a.cost > b.cost);
+}
+
+static inline void
+PathHeapUp(PathGrid* grid, int index)
+{
+    PathHeapEntry entry = grid->heap[index];
+    while (index > 0) {
+        int parent = (index - 1) / 2;
+        if (!PathHeapBefore(grid, entry, grid->heap[parent])) {
+            break;
+        }
+        grid->heap[index] = grid->heap[parent];
+        grid->heapIndex[grid->heap[index].tile] = index;
+        index = parent;
+    }
+    grid->heap[index] = entry;
+    grid->heapIndex[entry.tile] = index;
+}
+
+static inline int32_t
+PathHeapPop(PathGrid* grid)
+{
+    int32_t tile = grid->heap[0].tile;
+    PathHeapEntry last = grid->heap[--grid->heapCount];
+    int index = 0;
+    for (;;) {
+        int child = index * 2 + 1;
+        if (child >= grid->heapCount) {
+            break;
+        }
+        if (child + 1 < grid->heapCount && PathHeapBefore(grid, grid->heap[child + 1], grid->heap[child])) {
+            child++;
+        }
+        if (!PathHeapBefore(grid, grid->heap[child], last)) {
+            break;
+        }
+        grid->heap[index] = grid->heap[child];
+        grid->heapIndex[grid->heap[index].tile] = index;
+        index = child;
+    }
+    if (grid->heapCount > 0) {
+        grid->heap[index] = last;
+        grid->heapIndex[last.tile] = index;
+    }
+    return tile;
+}
+
+/* New stamp instead of clearing the per tile arrays */
+static inline void
+PathBeginQuery(PathGrid* grid)
+{
+    grid->query += 2;
+    if (grid->query == 0) {
+        memset(grid->stamp, 0, sizeof(uint32_t) * (size_t)grid->tileCount);
+        grid->query = 2;
+    }
+    grid->heapCount = 0;
+    grid->expanded = 0;
+}
+
+/* Puts the tile on the open list, or moves it up if this way is cheaper. Closed tiles are final */
+static inline void
+PathOpen(PathGrid* grid, int32_t tile, uint32_t cost, int32_t parent, uint32_t estimate)
+{
+    if (grid->stamp[tile] == grid->query + 1) {
+        return;
+    }
+    if (grid->stamp[tile] == grid->query) {
+        if (cost >= grid->cost[tile]) {
+            return;
+        }
+        grid->cost[tile] = cost;
+        grid->parent[tile] = parent;
+        int index = grid->heapIndex[tile];
+        grid->heap[index].score = cost + estimate;
+        grid->heap[index].cost = cost;
+        PathHeapUp(grid, index);
+        return;
+    }
+    grid->stamp[tile] = grid->query;
+    grid->cost[tile] = cost;
+    grid->parent[tile] = parent;
+    int index = grid->heapCount++;
+    grid->heap[index] = (PathHeapEntry){cost + estimate, cost, tile};
+    PathHeapUp(grid, index);
+}
+
+/*
+  Jump point from (x, y) onwards in (dx, dy), where (x, y) was just stepped
+  onto: the goal, a tile next to a wall the path could turn around, or on a
+  diagonal a tile a straight jump from it finds one. -1 when it runs into a wall
+*/
+static inline int32_t
+PathJump(const PathGrid* grid, int x, int y, int dx, int dy, int goalX, int goalY)
+{
+    for (;;) {
+        if (PathBlocked(grid, x, y)) {
+            return -1;
+        }
+        if (x == goalX && y == goalY) {
+            return y * grid->width + x;
+        }
+        if (dx != 0 && dy != 0) {
+            if (PathJump(grid, x + dx, y, dx, 0, goalX, goalY) != -1 ||
+                PathJump(grid, x, y + dy, 0, dy, goalX, goalY) != -1) {
+                return y * grid->width + x;
+            }
+        } else if (dx != 0) {
+            if ((!PathBlocked(grid, x, y - 1) && PathBlocked(grid, x - dx, y - 1)) ||
+                (!PathBlocked(grid, x, y + 1) && PathBlocked(grid, x - dx, y + 1))) {
+                return y * grid->width + x;
+            }
+        } else {
+            if ((!PathBlocked(grid, x - 1, y) && PathBlocked(grid, x - 1, y - dy)) ||
+                (!PathBlocked(grid, x + 1, y) && PathBlocked(grid, x + 1, y - dy))) {
+                return y * grid->width + x;
+            }
+        }
+        if (!PathCanStep(grid, x, y, dx, dy)) {
+            return -1;
+        }
+        x += dx;
+        y += dy;
+    }
+}
+
+/*
+  Directions worth trying from a tile reached going (dx, dy), all 8 from the
+  start. Straight runs also try both sides, a diagonal only its two halves
+*/
+static inline int
+PathJumpDirections(int dx, int dy, int directions[8][2])
+{
+    if (dx == 0 && dy == 0) {
+        memcpy(directions, pathDirections, sizeof(pathDirections));
+        return 8;
+    }
+    if (dx != 0 && dy != 0) {
+        int candidates[3][2] = {{dx, dy}, {dx, 0}, {0, dy}};
+        memcpy(directions, candidates, sizeof(candidates));
+        return 3;
+    }
+    if (dx != 0) {
+        int candidates[5][2] = {{dx, 0}, {dx, 1}, {dx, -1}, {0, 1}, {0, -1}};
+        memcpy(directions, candidates, sizeof(candidates));
+        return 5;
+    }
+    int candidates[5][2] = {{0, dy}, {1, dy}, {-1, dy}, {1, 0}, {-1, 0}};
+    memcpy(directions, candidates, sizeof(candidates));
+    return 5;
+}
+
+static inline int
+PathSign(int value)
+{
+    return (value > 0) - (value < 0);
+}
+
+/*
+  Tiles from the one after start to goal into tiles, at most maxTiles of them
+  (the first ones). Returns the whole path's length, 0 when start is goal,
+  PATH_NOT_FOUND when goal can't be reached or either end is blocked
+*/
+static inline int
+PathFind(PathGrid* grid, int startX, int startY, int goalX, int goalY, int* tiles, int maxTiles, PathSearch search)
+{
+    if (PathBlocked(grid, startX, startY) || PathBlocked(grid, goalX, goalY)) {
+        return PATH_NOT_FOUND;
+    }
+    int width = grid->width;
+    int32_t start = startY * width + startX;
+    int32_t goal = goalY * width + goalX;
+    PathBeginQuery(grid);
+    PathOpen(grid, start, 0, -1, PathOctile(goalX - startX, goalY - startY));
+
+    while (grid->heapCount > 0) {
+        int32_t tile = PathHeapPop(grid);
+        grid->stamp[tile] = grid->query + 1;
+        grid->expanded++;
+        if (tile == goal) {
+            break;
+        }
+
+        int x = tile % width;
+        int y = tile / width;
+        if (search == PATH_SEARCH_ASTAR) {
+            for (int i = 0; i < 8; i++) {
+                int dx = pathDirections[i][0];
+                int dy = pathDirections[i][1];
+                if (PathCanStep(grid, x, y, dx, dy)) {
+                    uint32_t step = (dx != 0 && dy != 0) ? PATH_COST_DIAGONAL : PATH_COST_STRAIGHT;
+                    PathOpen(grid, tile + dy * width + dx, grid->cost[tile] + step, tile,
+                             PathOctile(goalX - x - dx, goalY - y - dy));
+                }
+            }
+            continue;
+        }
+
+        int32_t parent = grid->parent[tile];
+        int directions[8][2];
+        int directionCount = parent == -1 ? PathJumpDirections(0, 0, directions) :
+            PathJumpDirections(PathSign(x - parent % width), PathSign(y - parent / width), directions);
+        for (int i = 0; i < directionCount; i++) {
+            int dx = directions[i][0];
+            int dy = directions[i][1];
+            if (!PathCanStep(grid, x, y, dx, dy)) {
+                continue;
+            }
+            int32_t jump = PathJump(grid, x + dx, y + dy, dx, dy, goalX, goalY);
+            if (jump != -1) {
+                int jumpX = jump % width;
+                int jumpY = jump / width;
+                PathOpen(grid, jump, grid->cost[tile] + PathOctile(jumpX - x, jumpY - y), tile,
+                         PathOctile(goalX - jumpX, goalY - jumpY));
+            }
+        }
+    }
+    if (grid->stamp[goal] != grid->query + 1) {
+        return PATH_NOT_FOUND;
+    }
+
+    /* Parents are a tile apart for A*, a straight or diagonal run apart for jumps */
+    int length = 0;
+    for (int32_t tile = goal; tile != start; tile = grid->parent[tile]) {
+        int32_t parent = grid->parent[tile];
+        int dx = abs(tile % width - parent % width);
+        int dy = abs(tile / width - parent / width);
+        length += dx > dy ? dx : dy;
+    }
+    int index = length;
+    for (int32_t tile = goal; tile != start; tile = grid->parent[tile]) {
+        int32_t parent = grid->parent[tile];
+        int stepX = PathSign(parent % width - tile % width);
+        int stepY = PathSign(parent / width - tile / width);
+        for (int32_t at = tile; at != parent; at += stepY * width + stepX) {
+            if (--index < maxTiles) {
+                tiles[index] = at;
+            }
+        }
+    }
+    return length;
+}
+
+static inline void
+PathFlowCacheInit(PathFlowCache* cache, void* memory, int radius)
+{
+    memset(cache, 0, sizeof(PathFlowCache));
+    cache->radius = radius;
+    cache->size = 2 * radius + 1;
+    for (int i = 0; i < PATH_MAX_FLOW_FIELDS; i++) {
+        cache->fields[i].targetX = -1;
+        cache->fields[i].directions = (uint8_t*)memory + (size_t)i * cache->size * cache->size;
+    }
+}
+
+/* Dijkstra out from the target, every tile reached points at the tile it was reached from */
+static inline void
+PathBuildFlowField(PathFlowCache* cache, PathGrid* grid, PathFlowField* field)
+{
+    int width = grid->width;
+    int size = cache->size;
+    memset(field->directions, PATH_NO_DIRECTION, (size_t)size * size);
+    cache->builds++;
+    if (PathBlocked(grid, field->targetX, field->targetY)) {
+        return;
+    }
+
+    PathBeginQuery(grid);
+    PathOpen(grid, field->targetY * width + field->targetX, 0, -1, 0);
+    while (grid->heapCount > 0) {
+        int32_t tile = PathHeapPop(grid);
+        grid->stamp[tile] = grid->query + 1;
+        grid->expanded++;
+        int x = tile % width;
+        int y = tile / width;
+        int32_t parent = grid->parent[tile];
+        if (parent != -1) {
+            int dx = parent % width - x;
+            int dy = parent / width - y;
+            for (int i = 0; i < 8; i++) {
+                if (pathDirections[i][0] == dx && pathDirections[i][1] == dy) {
+                    field->directions[(y - field->originY) * size + x - field->originX] = (uint8_t)i;
+                    break;
+                }
+            }
+        }
+
+        for (int i = 0; i < 8; i++) {
+            int dx = pathDirections[i][0];
+            int dy = pathDirections[i][1];
+            int nextX = x + dx;
+            int nextY = y + dy;
+            if (nextX < field->originX || nextY < field->originY ||
+                nextX >= field->originX + size || nextY >= field->originY + size ||
+                !PathCanStep(grid, x, y, dx, dy)) {
+                continue;
+            }
+            uint32_t step = (dx != 0 && dy != 0) ? PATH_COST_DIAGONAL : PATH_COST_STRAIGHT;
+            PathOpen(grid, nextY * width + nextX, grid->cost[tile] + step, tile, 0);
+        }
+    }
+}
+
+/* Cached field for the target, built (in place of the least recently used one) if there isn't one */
+static inline const PathFlowField*
+PathFlowFieldFor(PathFlowCache* cache, PathGrid* grid, int targetX, int targetY)
+{
+    cache->tick++;
+    PathFlowField* field = NULL;
+    for (int i = 0; i < PATH_MAX_FLOW_FIELDS && !field; i++) {
+        if (cache->fields[i].targetX == targetX && cache->fields[i].targetY == targetY) {
+            field = &cache->fields[i];
+        }
+    }
+    if (field && field->version == grid->version) {
+        field->lastUsed = cache->tick;
+        return field;
+    }
+
+    if (!field) {
+        field = &cache->fields[0];
+        for (int i = 1; i < PATH_MAX_FLOW_FIELDS; i++) {
+            if (cache->fields[i].lastUsed < field->lastUsed) {
+                field = &cache->fields[i];
+            }
+        }
+    }
+    field->targetX = targetX;
+    field->targetY = targetY;
+    field->originX = targetX - cache->radius;
+    field->originY = targetY - cache->radius;
+    field->version = grid->version;
+    field->lastUsed = cache->tick;
+    PathBuildFlowField(cache, grid, field);
+    return field;
+}
+
+/* Index into pathDirections to step toward the field's target, PATH_NO_DIRECTION when there is none */
+static inline int
+PathFlowDirection(const PathFlowCache* cache, const PathFlowField* field, int x, int y)
+{
+    int windowX = x - field->originX;
+    int windowY = y - field->originY;
+    if (windowX < 0 || windowY < 0 || windowX >= cache->size || windowY >= cache->size) {
+        return PATH_NO_DIRECTION;
+    }
+    return field->directions[windowY * cache->size + windowX];
+}
+
+#endif
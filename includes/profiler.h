@@ -0,0 +1,268 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+
+#if defined(PLATFORM_WEB)
+#include <emscripten/emscripten.h>
+#else
+#include <time.h>
+#endif
+
+/*
+  Frame profiler. Scopes are named by string literals and compared by pointer,
+  every Begin/End pair becomes an event in a ring buffer (for the Chrome trace)
+  and adds to its scope's totals for the frame (for the overlay).
+  Counters are plain numbers per frame, allocations, chunk bakes, anything.
+
+  Define PROFILER_DISABLED and the scope macros compile to nothing.
+*/
+#define PROFILER_MAX_SCOPES 64
+#define PROFILER_MAX_COUNTERS 16
+#define PROFILER_MAX_DEPTH 32
+#define PROFILER_HISTORY 128            // frames kept for the frame time graph
+
+typedef struct ProfileEvent
+{
+    const char* name;
+    double start;       // microseconds since ProfilerInit
+    float duration;     // microseconds
+    int depth;
+} ProfileEvent;
+
+typedef struct ProfileScope
+{
+    const char* name;
+    int depth;          // nesting depth the last time it ran
+    unsigned int calls; // this frame
+    unsigned int lastCalls;
+    double time;        // microseconds this frame
+    double lastTime;    // last finished frame
+    double averageTime; // moving average over frames
+    double maxTime;     // since the last ProfilerResetMax
+} ProfileScope;
+
+typedef struct ProfileCounter
+{
+    const char* name;
+    double value;       // this frame
+    double lastValue;   // last finished frame
+} ProfileCounter;
+
+typedef struct Profiler
+{
+    double startTime;
+    double frameStart;
+    float frameTimes[PROFILER_HISTORY]; // milliseconds, frameTimes[frameIndex] is the newest
+    int frameIndex;
+    unsigned long frame;
+
+    ProfileScope scopes[PROFILER_MAX_SCOPES];
+    int scopeCount;
+    ProfileCounter counters[PROFILER_MAX_COUNTERS];
+    int counterCount;
+
+    /* open scopes, index into scopes and when they started */
+    int stackScope[PROFILER_MAX_DEPTH];
+    double stackStart[PROFILER_MAX_DEPTH];
+    int depth;
+
+    /* ring of finished events, oldest ones are overwritten */
+    ProfileEvent* events;
+    size_t eventCapacity;
+    size_t eventCount;  // total ever recorded, index with % eventCapacity
+} Profiler;
+
+/* Usage */
+// Profiler p; ProfilerInit(&p, ArenaPushArray(&arena, ProfileEvent, 4096), 4096);
+// ProfilerFrameBegin(&p); ProfileCall(&p, UpdateGame()); ProfileCount(&p, "pushes", 3); ProfilerFrameEnd(&p);
+
+#ifndef PROFILER_DISABLED
+#define ProfileScopeBegin(p, name)  ProfileBegin((p), (name))
+#define ProfileScopeEnd(p)          ProfileEnd((p))
+#define ProfileCall(p, call)        do { ProfileBegin((p), #call); call; ProfileEnd((p)); } while (0)
+#else
+#define ProfileScopeBegin(p, name)  ((void)0)
+#define ProfileScopeEnd(p)          ((void)0)
+#define ProfileCall(p, call)        do { call; } while (0)
+#endif
+
+/* Microseconds from a monotonic clock, works without a window */
+static double
+ProfilerNow()
+{
+#if defined(PLATFORM_WEB)
+    return emscripten_get_now() * 1000.0;
+#elif defined(_WIN32)
+    /* windows.h clashes with raylib, timespec_get is close enough for frame timing */
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return (double)now.tv_sec * 1000000.0 + (double)now.tv_nsec / 1000.0;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1000000.0 + (double)now.tv_nsec / 1000.0;
+#endif
+}
+
+/* events can be NULL, then nothing is kept for the trace */
+static void
+ProfilerInit(Profiler* profiler, ProfileEvent* events, size_t eventCapacity)
+{
+    memset(profiler, 0, sizeof(Profiler));
+    profiler->events = events;
+    profiler->eventCapacity = events ? eventCapacity : 0;
+    profiler->startTime = ProfilerNow();
+    profiler->frameStart = profiler->startTime;
+}
+
+static int
+ProfilerFindScope(Profiler* profiler, const char* name)
+{
+    for (int i = 0; i < profiler->scopeCount; i++) {
+        if (profiler->scopes[i].name == name) {
+            return i;
+        }
+    }
+    if (profiler->scopeCount == PROFILER_MAX_SCOPES) {
+        return -1;
+    }
+    ProfileScope* scope = &profiler->scopes[profiler->scopeCount];
+    memset(scope, 0, sizeof(ProfileScope));
+    scope->name = name;
+    return profiler->scopeCount++;
+}
+
+/* name has to outlive the profiler, scopes are matched by pointer */
+static void
+ProfileBegin(Profiler* profiler, const char* name)
+{
+    if (profiler->depth == PROFILER_MAX_DEPTH) {
+        profiler->depth++; // still counted so the matching End lines up
+        return;
+    }
+    profiler->stackScope[profiler->depth] = ProfilerFindScope(profiler, name);
+    profiler->stackStart[profiler->depth] = ProfilerNow();
+    profiler->depth++;
+}
+
+static void
+ProfileEnd(Profiler* profiler)
+{
+    if (profiler->depth == 0) {
+        return;
+    }
+    profiler->depth--;
+    if (profiler->depth >= PROFILER_MAX_DEPTH || profiler->stackScope[profiler->depth] == -1) {
+        return;
+    }
+
+    double start = profiler->stackStart[profiler->depth];
+    double duration = ProfilerNow() - start;
+    ProfileScope* scope = &profiler->scopes[profiler->stackScope[profiler->depth]];
+    scope->calls++;
+    scope->time += duration;
+    scope->depth = profiler->depth;
+
+    if (profiler->eventCapacity > 0) {
+        ProfileEvent* event = &profiler->events[profiler->eventCount % profiler->eventCapacity];
+        event->name = scope->name;
+        event->start = start - profiler->startTime;
+        event->duration = (float)duration;
+        event->depth = profiler->depth;
+        profiler->eventCount++;
+    }
+}
+
+/* Adds to a named counter for this frame */
+static void
+ProfileCount(Profiler* profiler, const char* name, double amount)
+{
+    for (int i = 0; i < profiler->counterCount; i++) {
+        if (profiler->counters[i].name == name) {
+            profiler->counters[i].value += amount;
+            return;
+        }
+    }
+    if (profiler->counterCount < PROFILER_MAX_COUNTERS) {
+        ProfileCounter* counter = &profiler->counters[profiler->counterCount++];
+        counter->name = name;
+        counter->value = amount;
+        counter->lastValue = 0.0;
+    }
+}
+
+static void
+ProfilerFrameBegin(Profiler* profiler)
+{
+    profiler->frameStart = ProfilerNow();
+}
+
+/* Moves this frame's totals into last/average/max and clears them */
+static void
+ProfilerFrameEnd(Profiler* profiler)
+{
+    double frameTime = ProfilerNow() - profiler->frameStart;
+    profiler->frameIndex = (profiler->frameIndex + 1) % PROFILER_HISTORY;
+    profiler->frameTimes[profiler->frameIndex] = (float)(frameTime / 1000.0);
+    profiler->frame++;
+
+    for (int i = 0; i < profiler->scopeCount; i++) {
+        ProfileScope* scope = &profiler->scopes[i];
+        scope->lastTime = scope->time;
+        scope->lastCalls = scope->calls;
+        scope->averageTime += (scope->time - scope->averageTime) * 0.05;
+        if (scope->time > scope->maxTime) {
+            scope->maxTime = scope->time;
+        }
+        scope->time = 0.0;
+        scope->calls = 0;
+    }
+    for (int i = 0; i < profiler->counterCount; i++) {
+        profiler->counters[i].lastValue = profiler->counters[i].value;
+        profiler->counters[i].value = 0.0;
+    }
+}
+
+static void
+ProfilerResetMax(Profiler* profiler)
+{
+    for (int i = 0; i < profiler->scopeCount; i++) {
+        profiler->scopes[i].maxTime = 0.0;
+    }
+}
+
+/*
+  Writes the events still in the ring as a Chrome trace (chrome://tracing, Perfetto).
+  Scope names are written as is, they're expected to be identifiers or code
+*/
+static int
+ProfilerWriteTrace(const Profiler* profiler, const char* path)
+{
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        return 0;
+    }
+
+    size_t first = profiler->eventCount > profiler->eventCapacity ? profiler->eventCount - profiler->eventCapacity : 0;
+    fprintf(file, "{\"traceEvents\":[\n");
+    for (size_t i = first; i < profiler->eventCount; i++) {
+        const ProfileEvent* event = &profiler->events[i % profiler->eventCapacity];
+        fprintf(file, "%s{\"name\":\"", i == first ? "" : ",\n");
+        for (const char* c = event->name; *c; c++) {
+            if (*c == '"' || *c == '\\') {
+                fputc('\\', file);
+            }
+            fputc(*c, file);
+        }
+        fprintf(file, "\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1}",
+                event->start, (double)event->duration);
+    }
+    fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+    fclose(file);
+    return 1;
+}
+
+#endif
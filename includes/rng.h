@@ -0,0 +1,69 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+/*
+  PCG32, small seeded random numbers that come out the same on every
+  platform. A (seed, stream) pair is its own sequence, streams with the same
+  seed don't overlap, so a run seed plus the floor number gives every floor
+  its own numbers no matter what was generated before it.
+*/
+typedef struct Rng
+{
+    uint64_t state;
+    uint64_t increment;     // odd, picks the stream
+} Rng;
+
+/* Usage */
+// Rng r; RngSeed(&r, runSeed, floor);
+// int x = RngRange(&r, 1, 10); float t = RngFloat(&r);
+
+static inline uint32_t
+RngNext(Rng* rng)
+{
+    uint64_t old = rng->state;
+    rng->state = old * 6364136223846793005ull + rng->increment;
+    uint32_t shifted = (uint32_t)(((old >> 18) ^ old) >> 27);
+    uint32_t rotation = (uint32_t)(old >> 59);
+    return (shifted >> rotation) | (shifted << ((0u - rotation) & 31));
+}
+
+static inline void
+RngSeed(Rng* rng, uint64_t seed, uint64_t stream)
+{
+    rng->state = 0;
+    rng->increment = (stream << 1) | 1;
+    RngNext(rng);
+    rng->state += seed;
+    RngNext(rng);
+}
+
+/* 0 to bound - 1 without modulo bias, bound above 0 */
+static inline uint32_t
+RngBelow(Rng* rng, uint32_t bound)
+{
+    uint32_t threshold = (0u - bound) % bound;
+    for (;;) {
+        uint32_t value = RngNext(rng);
+        if (value >= threshold) {
+            return value % bound;
+        }
+    }
+}
+
+/* min to max, both included */
+static inline int
+RngRange(Rng* rng, int min, int max)
+{
+    return min + (int)RngBelow(rng, (uint32_t)(max - min) + 1);
+}
+
+/* [0, 1) */
+static inline float
+RngFloat(Rng* rng)
+{
+    return (RngNext(rng) >> 8) * (1.f / 16777216.f);
+}
+
+#endif
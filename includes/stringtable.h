@@ -0,0 +1,100 @@
+#ifndef STRINGTABLE_H
+#define STRINGTABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+  Compiled string table, one blob per language made by tools/textCompiler.c.
+
+    StringTableHeader
+    uint32_t offsets[count]     into data, STRING_TABLE_MISSING when the language doesn't have it
+    char data[dataSize]         the strings, each NUL terminated
+
+  A loaded table points straight into the blob (mapped or read in one go),
+  nothing is copied and a lookup is one index. keysHash is over the key names
+  in id order, a blob compiled from a different key list doesn't load.
+  Little endian, same as every platform the game builds for.
+*/
+#define STRING_TABLE_MAGIC "GSTR"
+#define STRING_TABLE_VERSION 1
+#define STRING_TABLE_MISSING 0xffffffffu
+#define STRING_TABLE_HASH_SEED 0xcbf29ce484222325ull
+
+typedef struct StringTableHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t count;
+    uint32_t dataSize;
+    uint64_t keysHash;
+} StringTableHeader;
+
+typedef struct StringTable
+{
+    const uint32_t* offsets;
+    const char* data;
+    uint32_t count;
+} StringTable;
+
+/* Usage */
+// StringTable t; StringTableLoad(&t, blob, blobSize, TEXT_COUNT, TEXT_KEYS_HASH);
+// const char* s = StringTableGet(&t, START_GAME); // NULL when missing
+
+/* FNV-1a over each key and its terminator, start from STRING_TABLE_HASH_SEED */
+static inline uint64_t
+StringTableHashKey(uint64_t hash, const char* key)
+{
+    const unsigned char* c = (const unsigned char*)key;
+    do {
+        hash = (hash ^ *c) * 0x100000001b3ull;
+    } while (*c++);
+    return hash;
+}
+
+/* 0 when the blob is damaged or was compiled for other keys, the table is left empty */
+static inline int
+StringTableLoad(StringTable* table, const void* blob, size_t size, uint32_t count, uint64_t keysHash)
+{
+    memset(table, 0, sizeof(StringTable));
+    StringTableHeader header;
+    if (!blob || size < sizeof(header)) {
+        return 0;
+    }
+    memcpy(&header, blob, sizeof(header));
+    if (memcmp(header.magic, STRING_TABLE_MAGIC, 4) != 0 || header.version != STRING_TABLE_VERSION ||
+        header.count != count || header.keysHash != keysHash ||
+        size != sizeof(header) + sizeof(uint32_t) * (size_t)header.count + header.dataSize) {
+        return 0;
+    }
+
+    const unsigned char* bytes = (const unsigned char*)blob;
+    const uint32_t* offsets = (const uint32_t*)(bytes + sizeof(header));
+    const char* data = (const char*)(offsets + header.count);
+    if (header.dataSize > 0 && data[header.dataSize - 1] != '\0') {
+        return 0;
+    }
+    for (uint32_t i = 0; i < header.count; i++) {
+        if (offsets[i] != STRING_TABLE_MISSING && offsets[i] >= header.dataSize) {
+            return 0;
+        }
+    }
+
+    table->offsets = offsets;
+    table->data = data;
+    table->count = header.count;
+    return 1;
+}
+
+/* NULL when the id is out of range or the table doesn't have it */
+static inline const char*
+StringTableGet(const StringTable* table, uint32_t id)
+{
+    if (id >= table->count || table->offsets[id] == STRING_TABLE_MISSING) {
+        return NULL;
+    }
+    return table->data + table->offsets[id];
+}
+
+#endif
@@ -0,0 +1,301 @@
+#ifndef TEXT_H
+#define TEXT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "../raylibIncludes/raylib.h"
+#include "../raylibIncludes/rlgl.h"
+#include "hashmap.h"
+
+/*
+  Text drawn from glyph atlases baked at the sizes the game uses. The default
+  font is a 10px bitmap, DrawTextEx scales every glyph of it on every draw,
+  an atlas has the glyphs already scaled (nearest neighbour so they stay crisp).
+
+  A string at a baked size becomes a TextRun: its quads, positioned relative to
+  the top left of the text with atlas texture coordinates, laid out once and
+  cached by (string, size). Drawing a run binds the atlas once and copies its
+  vertices into raylib's batch, no per glyph lookups or layout.
+  Printable ASCII only, other bytes are skipped.
+*/
+#define TEXT_FIRST_GLYPH 32
+#define TEXT_GLYPH_COUNT 95         // ' ' to '~'
+#define TEXT_MAX_ATLASES 4
+#define TEXT_ATLAS_WIDTH 512
+#define TEXT_ATLAS_PADDING 2        // between glyphs so point sampling never bleeds
+#define TEXT_SPACING 1.f            // between glyphs, same as the DrawTextEx calls it replaces
+#define TEXT_LINE_SPACING 15.f      // raylib's default
+#define TEXT_RUN_CAPACITY 256       // power of two, keep under ~70% full
+#define TEXT_MAX_RUNS 128
+#define TEXT_MAX_QUADS 4096
+#define TEXT_NO_RUN -1
+
+typedef struct TextGlyph
+{
+    Rectangle source;   // in the atlas texture
+    float offsetX;
+    float offsetY;
+    float advance;
+} TextGlyph;
+
+typedef struct TextAtlas
+{
+    Texture2D texture;
+    float size;         // font size it's drawn at
+    float scale;        // size / baked glyph size, 1 unless the size isn't a multiple of the font's
+    TextGlyph glyphs[TEXT_GLYPH_COUNT];
+} TextAtlas;
+
+typedef struct TextQuad
+{
+    float x0, y0, x1, y1;
+    float u0, v0, u1, v1;
+} TextQuad;
+
+typedef struct TextRun
+{
+    int atlas;
+    int firstQuad;
+    int quadCount;
+    Vector2 size;
+} TextRun;
+
+typedef struct TextCache
+{
+    TextAtlas atlases[TEXT_MAX_ATLASES];
+    int atlasCount;
+
+    /* TextKey -> index into runs, quads of a run are contiguous */
+    HashMap runLookup;
+    TextRun runs[TEXT_MAX_RUNS];
+    int runCount;
+    TextQuad* quads;
+    int quadCount;
+} TextCache;
+
+/* Usage */
+// TextCache t; TextCacheInit(&t, ArenaPush(&arena, TextCacheMemorySize, 16));
+// TextCacheAddAtlas(&t, GetFontDefault(), 40.f); TextDraw(&t, "Start Game", 40.f, position, BLACK);
+
+#define TextCacheMemorySize (HashMapMemorySize(TEXT_RUN_CAPACITY) + sizeof(TextQuad) * TEXT_MAX_QUADS)
+
+/* FNV-1a over the string, mixed with the font size */
+static inline uint64_t
+TextKey(const char* text, float fontSize)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (const unsigned char* c = (const unsigned char*)text; *c; c++) {
+        hash = (hash ^ *c) * 0x100000001b3ull;
+    }
+    uint32_t sizeBits;
+    memcpy(&sizeBits, &fontSize, sizeof(sizeBits));
+    return HashKey(hash ^ ((uint64_t)sizeBits << 32));
+}
+
+static inline void
+TextCacheInit(TextCache* cache, void* memory)
+{
+    memset(cache, 0, sizeof(TextCache));
+    HashMapInit(&cache->runLookup, memory, TEXT_RUN_CAPACITY);
+    cache->quads = (TextQuad*)((unsigned char*)memory + HashMapMemorySize(TEXT_RUN_CAPACITY));
+}
+
+/*
+  Bakes the font's glyphs at size into one texture, needs a window (GPU).
+  Glyphs are scaled by the nearest whole multiple of the font's base size.
+  Atlas index, -1 when there's no room for another
+*/
+static inline int
+TextCacheAddAtlas(TextCache* cache, Font font, float size)
+{
+    if (cache->atlasCount == TEXT_MAX_ATLASES || font.baseSize <= 0) {
+        return -1;
+    }
+    int scale = (int)(size / (float)font.baseSize + 0.5f);
+    if (scale < 1) {
+        scale = 1;
+    }
+
+    /* Shelf packing, rows left to right, the atlas is as tall as the rows need */
+    TextAtlas* atlas = &cache->atlases[cache->atlasCount];
+    memset(atlas, 0, sizeof(TextAtlas));
+    int x = TEXT_ATLAS_PADDING;
+    int y = TEXT_ATLAS_PADDING;
+    int rowHeight = 0;
+    for (int i = 0; i < TEXT_GLYPH_COUNT; i++) {
+        Rectangle rec = font.recs[GetGlyphIndex(font, TEXT_FIRST_GLYPH + i)];
+        int width = (int)rec.width * scale;
+        int height = (int)rec.height * scale;
+        if (x + width + TEXT_ATLAS_PADDING > TEXT_ATLAS_WIDTH) {
+            x = TEXT_ATLAS_PADDING;
+            y += rowHeight + TEXT_ATLAS_PADDING;
+            rowHeight = 0;
+        }
+        atlas->glyphs[i].source = (Rectangle){(float)x, (float)y, (float)width, (float)height};
+        x += width + TEXT_ATLAS_PADDING;
+        if (height > rowHeight) {
+            rowHeight = height;
+        }
+    }
+
+    Image image = GenImageColor(TEXT_ATLAS_WIDTH, y + rowHeight + TEXT_ATLAS_PADDING, BLANK);
+    for (int i = 0; i < TEXT_GLYPH_COUNT; i++) {
+        int index = GetGlyphIndex(font, TEXT_FIRST_GLYPH + i);
+        GlyphInfo* info = &font.glyphs[index];
+        TextGlyph* glyph = &atlas->glyphs[i];
+        glyph->offsetX = (float)(info->offsetX * scale);
+        glyph->offsetY = (float)(info->offsetY * scale);
+        glyph->advance = (float)((info->advanceX == 0 ? (int)font.recs[index].width : info->advanceX) * scale);
+        if (!info->image.data || glyph->source.width == 0.f || glyph->source.height == 0.f) {
+            continue;
+        }
+
+        /* ImageDraw would scale bilinear, so the glyph is resized nearest neighbour first */
+        Image scaled = ImageCopy(info->image);
+        ImageResizeNN(&scaled, (int)glyph->source.width, (int)glyph->source.height);
+        ImageDraw(&image, scaled, (Rectangle){0.f, 0.f, glyph->source.width, glyph->source.height}, glyph->source, WHITE);
+        UnloadImage(scaled);
+    }
+
+    atlas->texture = LoadTextureFromImage(image);
+    UnloadImage(image);
+    SetTextureFilter(atlas->texture, TEXTURE_FILTER_POINT);
+    atlas->size = size;
+    atlas->scale = size / (float)(font.baseSize * scale);
+    return cache->atlasCount++;
+}
+
+/* Atlas baked for this size, -1 when there isn't one */
+static inline int
+TextCacheFindAtlas(const TextCache* cache, float size)
+{
+    for (int i = 0; i < cache->atlasCount; i++) {
+        if (cache->atlases[i].size == size) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*
+  Run for the string at size, laid out the first time it's asked for.
+  text is hashed, not kept, the run stays valid if the string moves.
+  TEXT_NO_RUN when no atlas has the size or the cache is full
+*/
+static inline int
+TextCacheRun(TextCache* cache, const char* text, float size)
+{
+    uint64_t key = TextKey(text, size);
+    uint32_t found = HashMapGet(&cache->runLookup, key);
+    if (found != HASHMAP_NOT_FOUND) {
+        return (int)found;
+    }
+
+    int atlasIndex = TextCacheFindAtlas(cache, size);
+    int length = (int)strlen(text);
+    if (atlasIndex == -1 || cache->runCount == TEXT_MAX_RUNS || cache->quadCount + length > TEXT_MAX_QUADS) {
+        return TEXT_NO_RUN;
+    }
+
+    const TextAtlas* atlas = &cache->atlases[atlasIndex];
+    float textureWidth = (float)atlas->texture.width;
+    float textureHeight = (float)atlas->texture.height;
+    TextRun* run = &cache->runs[cache->runCount];
+    run->atlas = atlasIndex;
+    run->firstQuad = cache->quadCount;
+    run->quadCount = 0;
+
+    float x = 0.f;
+    float y = 0.f;
+    float width = 0.f;
+    for (const unsigned char* c = (const unsigned char*)text; *c; c++) {
+        if (*c == '\n') {
+            x = 0.f;
+            y += size + TEXT_LINE_SPACING;
+            continue;
+        }
+        if (*c < TEXT_FIRST_GLYPH || *c >= TEXT_FIRST_GLYPH + TEXT_GLYPH_COUNT) {
+            continue;
+        }
+
+        const TextGlyph* glyph = &atlas->glyphs[*c - TEXT_FIRST_GLYPH];
+        if (*c != ' ' && glyph->source.width > 0.f) {
+            TextQuad* quad = &cache->quads[run->firstQuad + run->quadCount++];
+            quad->x0 = x + glyph->offsetX * atlas->scale;
+            quad->y0 = y + glyph->offsetY * atlas->scale;
+            quad->x1 = quad->x0 + glyph->source.width * atlas->scale;
+            quad->y1 = quad->y0 + glyph->source.height * atlas->scale;
+            quad->u0 = glyph->source.x / textureWidth;
+            quad->v0 = glyph->source.y / textureHeight;
+            quad->u1 = (glyph->source.x + glyph->source.width) / textureWidth;
+            quad->v1 = (glyph->source.y + glyph->source.height) / textureHeight;
+        }
+        x += glyph->advance * atlas->scale;
+        if (x > width) {
+            width = x;
+        }
+        x += TEXT_SPACING;
+    }
+    run->size = (Vector2){width, y + size};
+
+    cache->quadCount += run->quadCount;
+    HashMapPut(&cache->runLookup, key, (uint32_t)cache->runCount);
+    return cache->runCount++;
+}
+
+/* One texture bind, the quads go straight into the current batch */
+static inline void
+TextDrawRun(const TextCache* cache, int runIndex, Vector2 position, Color tint)
+{
+    const TextRun* run = &cache->runs[runIndex];
+    if (run->quadCount == 0) {
+        return;
+    }
+    rlCheckRenderBatchLimit(4 * run->quadCount);
+    rlSetTexture(cache->atlases[run->atlas].texture.id);
+    rlBegin(RL_QUADS);
+    rlColor4ub(tint.r, tint.g, tint.b, tint.a);
+    rlNormal3f(0.f, 0.f, 1.f);
+    for (int i = 0; i < run->quadCount; i++) {
+        const TextQuad* quad = &cache->quads[run->firstQuad + i];
+        float x0 = position.x + quad->x0;
+        float y0 = position.y + quad->y0;
+        float x1 = position.x + quad->x1;
+        float y1 = position.y + quad->y1;
+        /* Same winding as DrawTexturePro */
+        rlTexCoord2f(quad->u0, quad->v0); rlVertex2f(x0, y0);
+        rlTexCoord2f(quad->u0, quad->v1); rlVertex2f(x0, y1);
+        rlTexCoord2f(quad->u1, quad->v1); rlVertex2f(x1, y1);
+        rlTexCoord2f(quad->u1, quad->v0); rlVertex2f(x1, y0);
+    }
+    rlEnd();
+    rlSetTexture(0);
+}
+
+/* Cached when there's an atlas for the size, DrawTextEx otherwise */
+static inline void
+TextDraw(TextCache* cache, const char* text, float size, Vector2 position, Color tint)
+{
+    int run = TextCacheRun(cache, text, size);
+    if (run == TEXT_NO_RUN) {
+        DrawTextEx(GetFontDefault(), text, position, size, TEXT_SPACING, tint);
+        return;
+    }
+    TextDrawRun(cache, run, position, tint);
+}
+
+static inline void
+TextCacheUnload(TextCache* cache)
+{
+    for (int i = 0; i < cache->atlasCount; i++) {
+        UnloadTexture(cache->atlases[i].texture);
+    }
+    cache->atlasCount = 0;
+    cache->runCount = 0;
+    cache->quadCount = 0;
+    memset(cache->runLookup.keys, 0, sizeof(uint64_t) * cache->runLookup.capacity);
+    cache->runLookup.count = 0;
+}
+
+#endif
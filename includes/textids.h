@@ -0,0 +1,35 @@
+/* Generated by tools/textCompiler.c from src/text/en.txt, don't edit */
+#ifndef TEXTIDS_H
+#define TEXTIDS_H
+
+typedef enum TextNames
+{
+    START_GAME,
+    OPTIONS,
+    EXIT_GAME,
+    SOUND,
+    CONTROLS,
+    MAIN_MENU,
+    INVENTORY,
+    CRAFTING,
+    MAP,
+    TEXT_COUNT,
+} TextNames;
+
+/* String tables compiled from other keys don't load */
+#define TEXT_KEYS_HASH 0xc4cc48fa9092d527ull
+
+/* Key names by id, shown when no loaded language has the string */
+static const char* textKeys[TEXT_COUNT] = {
+    "START_GAME",
+    "OPTIONS",
+    "EXIT_GAME",
+    "SOUND",
+    "CONTROLS",
+    "MAIN_MENU",
+    "INVENTORY",
+    "CRAFTING",
+    "MAP",
+};
+
+#endif
@@ -0,0 +1,333 @@
+#ifndef UI_H
+#define UI_H
+
+#include <stddef.h>
+#include <string.h>
+#include "../raylibIncludes/raylib.h"
+#include "hashmap.h"
+#include "text.h"
+
+/*
+  Retained UI. Widgets are declared once into a fixed table and keep their
+  layout between frames, only widgets marked dirty (new text, a resize) are
+  measured and placed again. Text sizes are cached per (string, font size) so
+  a string is measured once no matter how often layout runs.
+
+  A root widget is a vertical stack centered on an anchor (a fraction of the
+  screen), its children are buttons spaced `step` apart center to center.
+  Buttons of visible roots go into a hit list sorted by their top edge,
+  hit testing walks it and stops at the first rect below the point.
+  With a TextCache set, labels are drawn from cached text runs.
+*/
+#define UI_MAX_WIDGETS 64
+#define UI_TEXT_CACHE_CAPACITY 256  // power of two, keep under ~70% full
+#define UI_MAX_TEXTS 128
+#define UI_NONE -1
+#define UI_NO_ACTION 0
+
+typedef Vector2 (*UiMeasureFunc)(const char* text, float fontSize);
+
+typedef enum UiWidgetType
+{
+    UI_STACK,
+    UI_BUTTON,
+} UiWidgetType;
+
+typedef struct UiWidget
+{
+    UiWidgetType type;
+    int parent;
+    int firstChild;
+    int lastChild;
+    int nextSibling;
+    bool dirty;
+    bool visible;       // roots only, children follow their root
+
+    /* stack */
+    Vector2 anchor;     // center of the first child as a fraction of the screen
+    float step;         // distance between child centers
+
+    /* button */
+    const char* text;
+    float fontSize;
+    float padding;
+    int action;         // returned by UiUpdate when clicked, never UI_NO_ACTION
+    bool hovered;
+    int run;            // label's TextRun, TEXT_NO_RUN draws it with DrawTextEx
+
+    /* layout results */
+    Rectangle rect;
+    Vector2 textPosition;
+} UiWidget;
+
+typedef struct UiHit
+{
+    Rectangle rect;
+    int widget;
+} UiHit;
+
+typedef struct Ui
+{
+    UiWidget widgets[UI_MAX_WIDGETS];
+    int widgetCount;
+    Vector2 screenSize;
+
+    TextCache* text;    // NULL draws every label with DrawTextEx
+
+    /* text measurement cache, key from TextKey -> index into textSizes */
+    UiMeasureFunc measure;
+    HashMap textCache;
+    Vector2 textSizes[UI_MAX_TEXTS];
+    int textCount;
+    unsigned int measureCount; // cache misses, actual calls to measure
+
+    /* buttons of visible roots sorted by rect.y */
+    UiHit hits[UI_MAX_WIDGETS];
+    int hitCount;
+    bool hitsDirty;
+    int hovered;
+} Ui;
+
+/* Usage */
+// Ui ui; UiInit(&ui, ArenaPush(&arena, UiMemorySize, 16), Measure);
+// int menu = UiAddStack(&ui, (Vector2){0.5f, 0.25f}, 100.f); UiAddButton(&ui, menu, "Start", 40.f, ACTION_START);
+// UiResize(&ui, screen); switch (UiUpdate(&ui, mouse, clicked)) { case ACTION_START: ... } UiRender(&ui, menu);
+
+#define UiMemorySize HashMapMemorySize(UI_TEXT_CACHE_CAPACITY)
+
+static inline void
+UiInit(Ui* ui, void* memory, UiMeasureFunc measure)
+{
+    memset(ui, 0, sizeof(Ui));
+    ui->measure = measure;
+    ui->hovered = UI_NONE;
+    HashMapInit(&ui->textCache, memory, UI_TEXT_CACHE_CAPACITY);
+}
+
+/* Puts a known size in the cache, used when sizes come from somewhere other than measure */
+static inline void
+UiCacheText(Ui* ui, const char* text, float fontSize, Vector2 size)
+{
+    uint64_t key = TextKey(text, fontSize);
+    uint32_t index = HashMapGet(&ui->textCache, key);
+    if (index == HASHMAP_NOT_FOUND) {
+        if (ui->textCount == UI_MAX_TEXTS) {
+            return;
+        }
+        index = (uint32_t)ui->textCount++;
+        HashMapPut(&ui->textCache, key, index);
+    }
+    ui->textSizes[index] = size;
+}
+
+static inline Vector2
+UiMeasureText(Ui* ui, const char* text, float fontSize)
+{
+    uint32_t index = HashMapGet(&ui->textCache, TextKey(text, fontSize));
+    if (index != HASHMAP_NOT_FOUND) {
+        return ui->textSizes[index];
+    }
+    Vector2 size = ui->measure(text, fontSize);
+    ui->measureCount++;
+    UiCacheText(ui, text, fontSize, size);
+    return size;
+}
+
+static inline int
+UiAddWidget(Ui* ui, UiWidgetType type, int parent)
+{
+    if (ui->widgetCount == UI_MAX_WIDGETS) {
+        return UI_NONE;
+    }
+    int id = ui->widgetCount++;
+    UiWidget* widget = &ui->widgets[id];
+    memset(widget, 0, sizeof(UiWidget));
+    widget->type = type;
+    widget->parent = parent;
+    widget->firstChild = UI_NONE;
+    widget->lastChild = UI_NONE;
+    widget->nextSibling = UI_NONE;
+    widget->run = TEXT_NO_RUN;
+    widget->dirty = true;
+
+    if (parent != UI_NONE) {
+        UiWidget* parentWidget = &ui->widgets[parent];
+        if (parentWidget->lastChild == UI_NONE) {
+            parentWidget->firstChild = id;
+        } else {
+            ui->widgets[parentWidget->lastChild].nextSibling = id;
+        }
+        parentWidget->lastChild = id;
+        parentWidget->dirty = true;
+    }
+    return id;
+}
+
+/* Roots start hidden */
+static inline int
+UiAddStack(Ui* ui, Vector2 anchor, float step)
+{
+    int id = UiAddWidget(ui, UI_STACK, UI_NONE);
+    if (id != UI_NONE) {
+        ui->widgets[id].anchor = anchor;
+        ui->widgets[id].step = step;
+    }
+    return id;
+}
+
+/* text has to stay alive as long as the widget, it isn't copied */
+static inline int
+UiAddButton(Ui* ui, int parent, const char* text, float fontSize, int action)
+{
+    int id = UiAddWidget(ui, UI_BUTTON, parent);
+    if (id != UI_NONE) {
+        ui->widgets[id].text = text;
+        ui->widgets[id].fontSize = fontSize;
+        ui->widgets[id].padding = 10.f;
+        ui->widgets[id].action = action;
+    }
+    return id;
+}
+
+static inline void
+UiSetText(Ui* ui, int id, const char* text)
+{
+    if (ui->widgets[id].text != text) {
+        ui->widgets[id].text = text;
+        ui->widgets[id].dirty = true;
+    }
+}
+
+static inline void
+UiSetVisible(Ui* ui, int root, bool visible)
+{
+    if (ui->widgets[root].visible != visible) {
+        ui->widgets[root].visible = visible;
+        ui->hitsDirty = true;
+    }
+}
+
+/* Everything hangs off the screen size, so every root is laid out again */
+static inline void
+UiResize(Ui* ui, Vector2 screenSize)
+{
+    if (ui->screenSize.x == screenSize.x && ui->screenSize.y == screenSize.y) {
+        return;
+    }
+    ui->screenSize = screenSize;
+    for (int i = 0; i < ui->widgetCount; i++) {
+        if (ui->widgets[i].parent == UI_NONE) {
+            ui->widgets[i].dirty = true;
+        }
+    }
+}
+
+static inline void
+UiLayoutButton(Ui* ui, UiWidget* button, Vector2 center)
+{
+    Vector2 size = UiMeasureText(ui, button->text, button->fontSize);
+    button->rect = (Rectangle){center.x - size.x / 2.f - button->padding,
+                               center.y - size.y / 2.f - button->padding,
+                               size.x + button->padding * 2.f, size.y + button->padding * 2.f};
+    button->textPosition = (Vector2){button->rect.x + button->padding, button->rect.y + button->padding};
+    button->run = ui->text ? TextCacheRun(ui->text, button->text, button->fontSize) : TEXT_NO_RUN;
+    button->dirty = false;
+}
+
+/* A dirty root places all of its children, otherwise only the dirty children are placed */
+static inline void
+UiLayout(Ui* ui)
+{
+    for (int root = 0; root < ui->widgetCount; root++) {
+        UiWidget* stack = &ui->widgets[root];
+        if (stack->parent != UI_NONE) {
+            continue;
+        }
+
+        Vector2 center = {stack->anchor.x * ui->screenSize.x, stack->anchor.y * ui->screenSize.y};
+        for (int child = stack->firstChild; child != UI_NONE; child = ui->widgets[child].nextSibling) {
+            UiWidget* button = &ui->widgets[child];
+            if (stack->dirty || button->dirty) {
+                UiLayoutButton(ui, button, center);
+                ui->hitsDirty = true;
+            }
+            center.y += stack->step;
+        }
+        stack->dirty = false;
+    }
+
+    if (!ui->hitsDirty) {
+        return;
+    }
+    ui->hitCount = 0;
+    for (int root = 0; root < ui->widgetCount; root++) {
+        UiWidget* stack = &ui->widgets[root];
+        if (stack->parent != UI_NONE || !stack->visible) {
+            continue;
+        }
+        for (int child = stack->firstChild; child != UI_NONE; child = ui->widgets[child].nextSibling) {
+            /* insertion sort by top edge, there are only ever a handful */
+            UiHit hit = {ui->widgets[child].rect, child};
+            int at = ui->hitCount++;
+            while (at > 0 && ui->hits[at - 1].rect.y > hit.rect.y) {
+                ui->hits[at] = ui->hits[at - 1];
+                at--;
+            }
+            ui->hits[at] = hit;
+        }
+    }
+    ui->hitsDirty = false;
+}
+
+static inline int
+UiHitTest(const Ui* ui, Vector2 point)
+{
+    for (int i = 0; i < ui->hitCount; i++) {
+        const Rectangle* rect = &ui->hits[i].rect;
+        if (rect->y > point.y) {
+            break;
+        }
+        if (point.x >= rect->x && point.x < rect->x + rect->width && point.y < rect->y + rect->height) {
+            return ui->hits[i].widget;
+        }
+    }
+    return UI_NONE;
+}
+
+/* Lays out what's dirty, updates hover and returns the clicked button's action */
+static inline int
+UiUpdate(Ui* ui, Vector2 mouse, bool clicked)
+{
+    UiLayout(ui);
+
+    int hovered = UiHitTest(ui, mouse);
+    if (ui->hovered != UI_NONE) {
+        ui->widgets[ui->hovered].hovered = false;
+    }
+    ui->hovered = hovered;
+    if (hovered == UI_NONE) {
+        return UI_NO_ACTION;
+    }
+    ui->widgets[hovered].hovered = true;
+    return clicked ? ui->widgets[hovered].action : UI_NO_ACTION;
+}
+
+static inline void
+UiRender(const Ui* ui, int root)
+{
+    const UiWidget* stack = &ui->widgets[root];
+    if (!stack->visible) {
+        return;
+    }
+    for (int child = stack->firstChild; child != UI_NONE; child = ui->widgets[child].nextSibling) {
+        const UiWidget* button = &ui->widgets[child];
+        DrawRectangleLinesEx(button->rect, 1.f, button->hovered ? BLACK : RAYWHITE);
+        if (button->run != TEXT_NO_RUN) {
+            TextDrawRun(ui->text, button->run, button->textPosition, BLACK);
+        } else {
+            DrawTextEx(GetFontDefault(), button->text, button->textPosition, button->fontSize, TEXT_SPACING, BLACK);
+        }
+    }
+}
+
+#endif
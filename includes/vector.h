@@ -5,8 +5,24 @@
 #define VECTOR_IMPL
 #include <stdio.h>  
 #include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#endif
+
+/*
+  SIMD width used by MemMove/MemCopy. Only wasm SIMD128 (emcc -msimd128) gets
+  the kernel, on desktop the C library memmove/memcpy already beat it.
+  Define VECTOR_NO_SIMD to always use memmove/memcpy
+*/
+#if !defined(VECTOR_NO_SIMD) && defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#define VECTOR_SIMD_WIDTH 16
+typedef v128_t VectorSimd;
+#define VectorSimdLoad(p)       wasm_v128_load((p))
+#define VectorSimdStore(p,x)    wasm_v128_store((p),(x))
+#else
+#define VECTOR_SIMD_WIDTH 0
 #endif
-typedef unsigned long long size_t;/* Prints vector data's value member -> must be named value */
 #define vector(type) struct {type data; size_t length; size_t capacity;}
 #define VectorType(type) struct type
 #define OffsetOf(v,i) ((size_t)&(((v*)0)->i))
@@ -14,46 +30,61 @@ typedef unsigned long long size_t;/* Prints vector data's value member -> must b
 /* Usage */
 // typedef vector(desired type ptr) name -- EX: typedef vector(int*) vector
 
+/*
+  Capacity policy: grows by doubling when full, halves once length drops to a
+  quarter of capacity. The gap between the two means a push/pop pattern around
+  either point can't reallocate on every call. A failed realloc leaves data and
+  capacity as they were and the operation that needed the space does nothing.
+*/
+#define VECTOR_MIN_CAPACITY     4
+
 #define VectorLen(v)            ((v)->length)
 #define VectorCap(v)            ((v)->capacity)
-#define Vector(v)               ((v)->data = CreateVector(sizeof(*((v)->data)),4), \
-                                (v)->data ? (v)->length=0,(v)->capacity=4 : 0)
-#define VectorCanGrow(v,n)      ((VectorLen((v))+(n) > VectorCap((v))) ? VectorGrow((v),(v)->data,VectorLen((v))+(n),VectorCap(v)*2) : 0)
-#define VectorPush(v,val)       (VectorCanGrow((v),VectorLen((v))+1),(v)->data[v->length++]=(val)) 
+#define Vector(v)               ((v)->data = CreateVector(sizeof(*((v)->data)),VECTOR_MIN_CAPACITY), \
+                                (v)->length=0,(v)->capacity=(v)->data ? VECTOR_MIN_CAPACITY : 0)
+// 1 when there is room for n more elements, growing if needed
+#define VectorCanGrow(v,n)      ((VectorLen((v))+(n) <= VectorCap((v))) || \
+                                 (VectorGrow((v),VectorLen((v))+(n)), VectorLen((v))+(n) <= VectorCap((v))))
+#define VectorGrow(v,n)         (VectorSetCap((v),NextVectorCapacity(VectorCap((v)),(n))))
+#define VectorSetCap(v,n)       ((v)->data = ResizeVector((v)->data,sizeof*((v)->data),(n),&(v)->capacity))
+#define VectorReserve(v,n)      ((size_t)(n) > VectorCap((v)) ? (VectorSetCap((v),(n)),0) : 0)
+#define VectorShrinkToFit(v)    (VectorSetCap((v),VectorLen((v)) > VECTOR_MIN_CAPACITY ? VectorLen((v)) : VECTOR_MIN_CAPACITY))
+#define VectorPush(v,val)       (VectorCanGrow((v),1) ? ((v)->data[(v)->length++]=(val),1) : 0)
 #define VectorPushFront(v,val)  (VectorInsert(v,0,val))
-#define VectorGrow(v,d,l,n)     ((d) = GrowVector((d), sizeof*((d)),(l),(n),&(v)->capacity))
-#define VectorFree(v)           ((void) ((v)->data ? free((v).data) : (void)0),(v)->data=NULL)
+#define VectorFree(v)           (free((v)->data),(v)->data=NULL,(v)->length=0,(v)->capacity=0)
 #define VectorLast(v)           ((v)->data[(v)->length-1])
 #define VectorPop(v)            ((v)->length--,ResizeCapacity(v))
-#define VectorInsert(v,i,val)   (VectorValidIndex(v,i) ? VectorCanGrow((v),1),(v)->length+=1, \
-                                 MemMove(&(v)->data[i+1],&(v)->data[i],sizeof*((v)->data)*(v)->length-1-(i)), \
-                                 (v)->data[i]=(val) : 0) 
+#define VectorInsert(v,i,val)   ((VectorValidInsert(v,i) && VectorCanGrow((v),1)) ? ((v)->length+=1, \
+                                 MemMove(&(v)->data[(i)+1],&(v)->data[i],sizeof*((v)->data)*((v)->length-1-(i))), \
+                                 (v)->data[i]=(val),1) : 0) 
 // vector,index,value,count
-#define VectorInsertN(v,i,val,c)(VectorValidIndex(v,i) ?  VectorCanGrow((v),(c)), (v)->length+=(c), \
-                                 MemMove(&((v)->data[(i)+(c)]),&((v)->data[i]),sizeof(*((v)->data))*(v)->length-(c)-(i)) : 0); \
-                                 for(int j=i;j<((i)+(c));j++)(v)->data[j]=(val);
-#define VectorDelete(v,i)       (VectorValidIndex(v,i) ? MemMove(&((v)->data)[i],&((v)->data)[i+1],sizeof(*((v)->data))*(v)->length-(i)-1), \
+#define VectorInsertN(v,i,val,c)if (VectorValidInsert(v,i) && VectorCanGrow((v),(c))) { (v)->length+=(c); \
+                                 MemMove(&((v)->data[(i)+(c)]),&((v)->data[i]),sizeof(*((v)->data))*((v)->length-(c)-(i))); \
+                                 for(size_t j=(i);j<(size_t)((i)+(c));j++)(v)->data[j]=(val); }
+#define VectorDelete(v,i)       (VectorValidIndex(v,i) ? MemMove(&((v)->data)[i],&((v)->data)[(i)+1],sizeof(*((v)->data))*((v)->length-(i)-1)), \
                                  (v)->length--, ResizeCapacity(v) : 0) 
 #define VectorDeleteSwap(v,i)   ((v)->data[i] = VectorLast(v), (v)->length--, ResizeCapacity(v))
-#define VectorDeleteN(v,i,n)    (VectorValidIndex((v),(i)) ? MemMove(&((v)->data)[i],&((v)->data)[(i)+(n)], sizeof(*((v)->data))*(v)->length-(i)-(n)), \
+#define VectorDeleteN(v,i,n)    (VectorValidIndex((v),(i)) ? MemMove(&((v)->data)[i],&((v)->data)[(i)+(n)], sizeof(*((v)->data))*((v)->length-(i)-(n))), \
                                  (v)->length-=(n),ResizeCapacity(v) : 0)
-#define VectorPopFront(v)       (MemMove(&((v)->data[0]),&((v)->data)[1], sizeof(*((v)->data))*(v)->length-1), (v)->length--,ResizeCapacity(v))
+#define VectorPopFront(v)       (MemMove(&((v)->data[0]),&((v)->data)[1], sizeof(*((v)->data))*((v)->length-1)), (v)->length--,ResizeCapacity(v))
 #define VectorEmpty(v)          (!(v)->length ? 1 : 0)
 #define VectorItemAt(v,i)       (VectorValidIndex(v,i) ? (v)->data[i] : 0)
-#define VectorValidIndex(v,i)   (((i)<=(v)->length-1)&&((i)>0||(i)==0))      
-#define ResizeCapacity(v)       ((((v)->length < (v)->capacity/2)||((v)->length == (v)->capacity/4)) ? \
-                                 GrowVector((v)->data,sizeof(*(v)->data), 0, (v)->capacity/2,&(v)->capacity), \
-                                 (v)->capacity = (v)->capacity/2 : 0)
+#define VectorValidIndex(v,i)   ((size_t)(i) < (v)->length)
+// inserting can also go at the end, i == length
+#define VectorValidInsert(v,i)  ((size_t)(i) <= (v)->length)
+#define ResizeCapacity(v)       (((v)->length <= (v)->capacity/4 && (v)->capacity > VECTOR_MIN_CAPACITY) ? \
+                                 (VectorSetCap((v),(v)->capacity/2),1) : 0)
 
-/* Double Pointer with member name "value"*/
+/* Double Pointer with member name "value", idx is -1 when val isn't found */
 #define VectorPtrSearch(data,val,len,idx)\
-for(int i = 0; i < len; i++)                \
-    if(data[i]->value == val) {             \
-        index=i;                            \
-        break;                              \
-    } else {                                \
-        index=-1;                           \
-    }                                       
+do {                                        \
+    (idx) = -1;                             \
+    for(int i = 0; i < (len); i++)          \
+        if((data)[i]->value == (val)) {     \
+            (idx) = i;                      \
+            break;                          \
+        }                                   \
+} while (0)
                                            
 #define VectorPtrPrint(data,len,offset)\
 for(int i = 0; i < len; i++){          \
@@ -69,15 +100,17 @@ for(int i = 0; i < len; i++){       \
         printf("\n");               \
 }
 
+/* idx is -1 when val isn't found */
 #define VectorSearch(data,val,len,idx)\
-for (int i = 0; i < len; i++){        \
-    if(data[i] == val) {              \
-        index=i;                      \
-        break;                        \
-    } else {                          \
-        index=-1;                     \
+do {                                  \
+    (idx) = -1;                       \
+    for (int i = 0; i < (len); i++){  \
+        if((data)[i] == (val)) {      \
+            (idx) = i;                \
+            break;                    \
+        }                             \
     }                                 \
-}              
+} while (0)
 
 /* Prints vector data's value member -> must be named value */
 #define VectorStructPrint(data,len,offset) \
@@ -99,59 +132,159 @@ CreateVector(size_t elemSize, size_t cap)
     return NULL;
 }
 
-static void*
-GrowVector(void* data, size_t elemSize, size_t addLen, size_t cap, void* actualCap)
+/* Doubles until there is room for needed elements */
+static size_t
+NextVectorCapacity(size_t cap, size_t needed)
 {
-    void*b;
-    size_t* c = (size_t*)actualCap;
-    if (addLen > cap) {
-        cap = addLen;
-        if (cap%2!=0) cap++;
-        cap*=2;
+    if (cap < VECTOR_MIN_CAPACITY) {
+        cap = VECTOR_MIN_CAPACITY;
     }
-    
-    *c = cap;
+    while (cap < needed) {
+        cap *= 2;
+    }
+    return cap;
+}
 
+/* On failure the old block and capacity are kept, realloc doesn't free it */
+static void*
+ResizeVector(void* data, size_t elemSize, size_t cap, size_t* actualCap)
+{
+    void*b;
     b = realloc(data, elemSize * cap);
     if (b) {
+        *actualCap = cap;
         return b;
     }
     printf("Failed to reallocate memory.\n");
-    return NULL;
+    return data;
 }
 
-/*https://github.com/gcc-mirror/gcc/blob/master/libgcc/memmove.c*/
+/*
+  Overlap safe copy. Small copies go to the C library, bigger ones move a SIMD
+  register at a time with aligned stores. Going forwards when dst is below src
+  and backwards otherwise means a store never lands on source bytes that
+  haven't been loaded yet, whatever the distance between the two.
+*/
 static void*
 MemMove(void* dst, const void* src, size_t size)
 {
+#if VECTOR_SIMD_WIDTH
+    unsigned char* d = (unsigned char*)dst;
+    const unsigned char* s = (const unsigned char*)src;
+    if (size < VECTOR_SIMD_WIDTH * 2 || d == s) {
+        return memmove(dst, src, size);
+    }
     
-    char* d = (char*)dst;
-    const char* s = (char*)src;
     // forwards
     if (d < s) {
+        while ((size_t)d & (VECTOR_SIMD_WIDTH - 1)) {
+            *d++ = *s++;
+            size--;
+        }
+        /* all four loads happen before any of their stores */
+        while (size >= VECTOR_SIMD_WIDTH * 4) {
+            VectorSimd x0 = VectorSimdLoad(s);
+            VectorSimd x1 = VectorSimdLoad(s + VECTOR_SIMD_WIDTH);
+            VectorSimd x2 = VectorSimdLoad(s + VECTOR_SIMD_WIDTH * 2);
+            VectorSimd x3 = VectorSimdLoad(s + VECTOR_SIMD_WIDTH * 3);
+            VectorSimdStore(d, x0);
+            VectorSimdStore(d + VECTOR_SIMD_WIDTH, x1);
+            VectorSimdStore(d + VECTOR_SIMD_WIDTH * 2, x2);
+            VectorSimdStore(d + VECTOR_SIMD_WIDTH * 3, x3);
+            d += VECTOR_SIMD_WIDTH * 4;
+            s += VECTOR_SIMD_WIDTH * 4;
+            size -= VECTOR_SIMD_WIDTH * 4;
+        }
+        while (size >= VECTOR_SIMD_WIDTH) {
+            VectorSimd x = VectorSimdLoad(s);
+            VectorSimdStore(d, x);
+            d += VECTOR_SIMD_WIDTH;
+            s += VECTOR_SIMD_WIDTH;
+            size -= VECTOR_SIMD_WIDTH;
+        }
         while (size--) {
             *d++ = *s++;
         }
     // backwards
     } else {
-        char* lasts = (char*)s + (size-1);
-        char* lastd = d + (size-1);
+        d += size;
+        s += size;
+        while ((size_t)d & (VECTOR_SIMD_WIDTH - 1)) {
+            *--d = *--s;
+            size--;
+        }
+        while (size >= VECTOR_SIMD_WIDTH * 4) {
+            d -= VECTOR_SIMD_WIDTH * 4;
+            s -= VECTOR_SIMD_WIDTH * 4;
+            size -= VECTOR_SIMD_WIDTH * 4;
+            VectorSimd x3 = VectorSimdLoad(s + VECTOR_SIMD_WIDTH * 3);
+            VectorSimd x2 = VectorSimdLoad(s + VECTOR_SIMD_WIDTH * 2);
+            VectorSimd x1 = VectorSimdLoad(s + VECTOR_SIMD_WIDTH);
+            VectorSimd x0 = VectorSimdLoad(s);
+            VectorSimdStore(d + VECTOR_SIMD_WIDTH * 3, x3);
+            VectorSimdStore(d + VECTOR_SIMD_WIDTH * 2, x2);
+            VectorSimdStore(d + VECTOR_SIMD_WIDTH, x1);
+            VectorSimdStore(d, x0);
+        }
+        while (size >= VECTOR_SIMD_WIDTH) {
+            d -= VECTOR_SIMD_WIDTH;
+            s -= VECTOR_SIMD_WIDTH;
+            size -= VECTOR_SIMD_WIDTH;
+            VectorSimd x = VectorSimdLoad(s);
+            VectorSimdStore(d, x);
+        }
         while (size--) {
-            *lastd-- = *lasts--;
+            *--d = *--s;
         }
     }
     return dst;
+#else
+    return memmove(dst, src, size);
+#endif
 }
 
+/* Buffers must not overlap, head and tail are done with one overlapping register each */
 static void*
-MemCopy(void* dest, void* src, size_t size)
+MemCopy(void* dest, const void* src, size_t size)
 {
-    char* d = (char*)dest;
-    char* s = (char*)src;
-    while(size--) {
-        *d++ = *s++;
+#if VECTOR_SIMD_WIDTH
+    unsigned char* d = (unsigned char*)dest;
+    const unsigned char* s = (const unsigned char*)src;
+    if (size < VECTOR_SIMD_WIDTH * 2) {
+        return memcpy(dest, src, size);
+    }
+    
+    size_t head = VECTOR_SIMD_WIDTH - ((size_t)d & (VECTOR_SIMD_WIDTH - 1));
+    VectorSimdStore(d, VectorSimdLoad(s));
+    d += head;
+    s += head;
+    size -= head;
+    while (size >= VECTOR_SIMD_WIDTH * 4) {
+        VectorSimd x0 = VectorSimdLoad(s);
+        VectorSimd x1 = VectorSimdLoad(s + VECTOR_SIMD_WIDTH);
+        VectorSimd x2 = VectorSimdLoad(s + VECTOR_SIMD_WIDTH * 2);
+        VectorSimd x3 = VectorSimdLoad(s + VECTOR_SIMD_WIDTH * 3);
+        VectorSimdStore(d, x0);
+        VectorSimdStore(d + VECTOR_SIMD_WIDTH, x1);
+        VectorSimdStore(d + VECTOR_SIMD_WIDTH * 2, x2);
+        VectorSimdStore(d + VECTOR_SIMD_WIDTH * 3, x3);
+        d += VECTOR_SIMD_WIDTH * 4;
+        s += VECTOR_SIMD_WIDTH * 4;
+        size -= VECTOR_SIMD_WIDTH * 4;
+    }
+    while (size >= VECTOR_SIMD_WIDTH) {
+        VectorSimdStore(d, VectorSimdLoad(s));
+        d += VECTOR_SIMD_WIDTH;
+        s += VECTOR_SIMD_WIDTH;
+        size -= VECTOR_SIMD_WIDTH;
+    }
+    if (size) {
+        VectorSimdStore(d + size - VECTOR_SIMD_WIDTH, VectorSimdLoad(s + size - VECTOR_SIMD_WIDTH));
     }
     return dest;
+#else
+    return memcpy(dest, src, size);
+#endif
 }
 
 #endif
@@ -1,8 +1,26 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <time.h>
 #include "../raylibIncludes/raylib.h"
 #include "../raylibIncludes/raymath.h"
+#include "../includes/arena.h"
+#include "../includes/hashmap.h"
+#include "../includes/containers.h"
+#include "../includes/entities.h"
+#include "../includes/profiler.h"
+#include "../includes/text.h"
+#include "../includes/ui.h"
+#include "../includes/stringtable.h"
+#include "../includes/assets.h"
+#include "../includes/lighting.h"
+#include "../includes/pathfinding.h"
+#include "../includes/jobs.h"
+#include "../includes/floorgen.h"
+#include "../includes/textids.h"
 
 /* DEFINES */
 #if defined(PLATFORM_WEB)
@@ -13,12 +31,76 @@ EM_JS(int, CanvasGetWidth, (), {
 EM_JS(int, CanvasGetHeight, (), {
     return document.getElementById('canvas').clientHeight;
 });
+/* Files written on web only exist in memory, this hands one to the browser as a download */
+EM_JS(void, DownloadFile, (const char* path), {
+    var name = UTF8ToString(path);
+    var blob = new Blob([FS.readFile(name)]);
+    var link = document.createElement('a');
+    link.href = URL.createObjectURL(blob);
+    link.download = name.split('/').pop();
+    link.click();
+    URL.revokeObjectURL(link.href);
+});
+#endif
+
+/* Map files are memory mapped where mmap exists, read in one go everywhere else */
+#if !defined(PLATFORM_WEB) && !defined(_WIN32)
+#define MAP_FILES_WITH_MMAP 1
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#else
+#define MAP_FILES_WITH_MMAP 0
 #endif
 
 #define DEBUG 1
 #define MAX_INVENTORY_ITEMS 25
+#define INVENTORY_COLUMNS 5
+#define INVENTORY_SLOT_PADDING 4.f
+#define MAX_RECIPE_INGREDIENTS 5
+#define RECIPE_MAP_CAPACITY 256     // power of two, keep the recipe count under ~70% of it
 #define DEFAULT_MAP_SIZE 5
+#define MAP_VIEW_TILES 10           // tiles across the screen on each axis
+#define MAP_CHUNK_SIZE 8            // tiles per chunk on each axis
+#define MAP_CHUNK_MAX_TEXELS 64     // max texels per tile in a chunk texture
+#define MAP_MAX_RESIDENT_CHUNKS 32  // covers the view plus one ring of neighbours
+#define MAP_CHUNK_PREFETCH_PER_FRAME 1
+#define MAP_CHUNK_PRELOAD_PER_FRAME 2   // view chunks baked per frame while the game scene preloads
+#define MAP_FILE_MAGIC "GMAP"
+#define MAP_FILE_VERSION 1
+#define PLAYER_LIGHT_RADIUS 8       // tiles the player sees and lights
+#define PLAYER_LIGHT_INTENSITY 255
+#define MAP_FLOW_FIELD_RADIUS 24    // tiles from the player shadow monsters find their way in
+#define SHADOW_MONSTER_SPEED 3.f    // tiles per second
+#define FLOOR_BASE_SIZE 40          // tiles across the first generated floor, floor 0 is gameMap.csv
+#define FLOOR_SIZE_STEP 8           // each floor up is this much wider and taller
+#define FLOOR_MAX_SIZE 128
 #define DEFAULT_BATTLE_SCENE_RECTS_COUNT 2
+#define MAX_ENTITIES 4096           // player, enemies and shadow monsters together
+#define PLAYER_SPEED 8.f            // tiles per second
+#define SIMULATION_HZ 60
+#define SIMULATION_STEP (1.f / SIMULATION_HZ)
+#define MAX_SIMULATION_STEPS_PER_FRAME 8   // after a long stall time is dropped instead of caught up
+#define SIMULATE_ENTITY_COUNT 1024         // wandering entities spawned by --simulate
+#define MENU_FONT_SIZE 40.f
+#define REPLAY_FILE_MAGIC "GREC"
+#define REPLAY_FILE_VERSION 5
+#define MAX_SCENES 8
+#define MAX_SCENE_REQUESTS 8                 // power of two
+#define PROFILER_TRACE_EVENTS 8192          // most recent scope events kept for the trace export
+#define PROFILER_TRACE_PATH "profile.json"
+#if defined (PLATFORM_WEB)
+#define TEXT_DIRECTORY "text/"
+#define ASSET_DIRECTORY "assets/"
+#else
+#define TEXT_DIRECTORY "src/text/"
+#define ASSET_DIRECTORY "src/assets/"
+#endif
+#define JOB_WORKER_THREADS 3         // besides the main thread
+#define GAME_PERMANENT_MEMORY_SIZE (1 * 1024 * 1024)
+#define GAME_LEVEL_MEMORY_SIZE (16 * 1024 * 1024)
+#define GAME_FRAME_MEMORY_SIZE (256 * 1024)
 
 typedef struct Vector2i
 {
@@ -31,51 +113,237 @@ typedef struct GameSettings
   bool soundOn;
 } GameSettings;
 
-typedef struct ControlsMenu
+/* Menus are retained UI trees, clicking a button hands its action to the menu's update */
+typedef enum MenuAction
 {
-  float fontSize;
-} ControlsMenu;
+  MENU_ACTION_NONE = UI_NO_ACTION,
+  MENU_ACTION_START_GAME,
+  MENU_ACTION_OPTIONS,
+  MENU_ACTION_EXIT_GAME,
+  MENU_ACTION_TOGGLE_SOUND,
+  MENU_ACTION_CONTROLS,
+  MENU_ACTION_MAIN_MENU,
+} MenuAction;
 
-typedef struct MainMenu
+/* Values in the map csv, anything else is drawn but is plain floor to everything else */
+typedef enum TileType
 {
-  float fontSize;
+  TILE_FLOOR,
+  TILE_WALL,
+  TILE_TORCH,               // wall with a light on it
+  TILE_STAIRS,              // up to the next floor
+  TILE_TORCH_OUT,           // torch the player put out, can be lit again
+  TILE_TYPE_COUNT,
+} TileType;
 
-  Rectangle startGameRect;
-  Color startGameRectColor;
-  Vector2 startGameTextPosition;
-  
-  Rectangle gotoOptionsMenuRect;
-  Color gotoOptionsMenuRectColor;
-  Vector2 gotoOptionsMenuTextPosition;
+typedef struct TileProperties
+{
+  bool solid;               // nothing walks through it
+  bool blocksLight;
+  int lightRadius;          // 0 for no light
+  unsigned char lightIntensity;
+} TileProperties;
+
+/*
+  Tile types for the whole map live in one dense array,
+  tile i is at (i % width, i / width).
+  Everything needed to draw the map is kept per chunk of
+  MAP_CHUNK_SIZE x MAP_CHUNK_SIZE tiles, and only chunks around the
+  camera view are resident, so render memory doesn't grow with the map.
+*/
+typedef struct GameMap
+{
+  int width;
+  int height;
+  int tileCount;
+  Vector2 tileSize;
+  int hoveredTile; // -1 when the mouse is off the map
+  int* tileTypes;
+
+  Camera2D camera;
+  unsigned int frame;
+  Vector2i chunkCount;
+  Vector2i chunkTexelSize;
+  Vector2i visibleChunkMin;
+  Vector2i visibleChunkMax;
+
+  /* Resident chunk slots, a slot is free when its coord is (-1,-1) */
+  Vector2i chunkCoords[MAP_MAX_RESIDENT_CHUNKS];
+  unsigned int chunkLastUsed[MAP_MAX_RESIDENT_CHUNKS];
+  RenderTexture2D chunkTextures[MAP_MAX_RESIDENT_CHUNKS];
+
+  /* Torches and the player's light, fog of war is what the player's light doesn't reach */
+  LightMap light;
+  int playerLight;
+
+  /* Per tile TileProperties.solid, what paths go around */
+  unsigned char* solid;
+  PathGrid path;
+  PathFlowCache flowFields;
+} GameMap;
+
+/* Ingredients are a multiset, the order they go into the crafting inventory doesn't matter */
+typedef struct Recipe
+{
+  int ingredients[MAX_RECIPE_INGREDIENTS];
+  int ingredientCount;
+  int result;
+} Recipe;
+
+typedef struct RecipeBook
+{
+  const Recipe* recipes;
+  int recipeCount;
+  HashMap byIngredients;     // HashMultiset of the ingredients -> recipe index
+  SortedIndex byResult;      // result item id -> recipe index
+} RecipeBook;
+
+/* Binary map cache, followed by width*height raw int tile types */
+typedef struct GameMapFileHeader
+{
+  char magic[4];
+  int version;
+  int width;
+  int height;
+} GameMapFileHeader;
+
+typedef struct MappedFile
+{
+  unsigned char* data;
+  size_t size;
+  bool mapped;
+} MappedFile;
+
+/* Languages the game has string tables for, TextNames ids come from textids.h */
+typedef enum Language
+{
+  LANGUAGE_EN,
+  LANGUAGE_ES,
+  LANGUAGE_COUNT,
+} Language;
+
+/*
+  Scenes live on a stack, the top one is what the player is looking at.
+  An opaque scene hides everything under it, those scenes skip update and render.
+  Overlays (inventory, crafting) aren't opaque so the game keeps running under them.
+*/
+typedef enum SceneId
+{
+  SCENE_NONE = -1,
+  SCENE_MAIN_MENU,
+  SCENE_OPTIONS_MENU,
+  SCENE_CONTROLS_MENU,
+  SCENE_GAME,
+  SCENE_INVENTORY,
+  SCENE_CRAFTING,
+  SCENE_COUNT,
+} SceneId;
+
+/* Any of these can be NULL */
+typedef struct Scene
+{
+  const char* name;
+  bool opaque;
+  void (*enter)();
+  void (*exit)();
+  void (*update)();
+  void (*render)();
+  /*
+    Called once a frame before the scene goes on the stack, a slice of work each time,
+    until it returns true. progress starts at 0 and is the preload's to use
+  */
+  bool (*preload)(int* progress);
+  const char* atlas;        // held while the scene is on the stack (or preloading), NULL for none
+} Scene;
+
+/* Stack changes asked for during update, applied once the frame's updates are done */
+typedef enum SceneRequestType
+{
+  SCENE_REQUEST_PUSH,
+  SCENE_REQUEST_SET,        // pops everything, then pushes
+  SCENE_REQUEST_POP,
+  SCENE_REQUEST_REMOVE,     // wherever it is in the stack
+  SCENE_REQUEST_RAISE,      // moves it to the top
+} SceneRequestType;
+
+typedef struct SceneRequest
+{
+  SceneRequestType type;
+  SceneId scene;
+} SceneRequest;
 
-  Rectangle exitGameRect;
-  Color exitGameRectColor;
-  Vector2 exitGameTextPosition;
-} MainMenu;
+DEFINE_RING(SceneRequestRing, SceneRequest, MAX_SCENE_REQUESTS)
 
-typedef struct OptionsMenu
+typedef struct SceneStack
 {
-  float fontSize;
+  SceneId scenes[MAX_SCENES];
+  int count;
+  SceneRequestRing requests;
+
+  /* scene whose preload is running, pushed once it finishes */
+  SceneId loading;
+  bool loadingReplaces;     // it was a SET, the stack is cleared first
+  int loadingProgress;
+} SceneStack;
 
-  Rectangle soundToggleRect;
-  Color soundToggleRectColor;
-  Vector2 soundToggleTextPosition;
+/* Game actions, each one is bound to raylib keys in gameKeyBindings */
+typedef enum GameKey
+{
+  GAME_KEY_LEFT,
+  GAME_KEY_RIGHT,
+  GAME_KEY_UP,
+  GAME_KEY_DOWN,
+  GAME_KEY_INVENTORY,
+  GAME_KEY_CRAFTING,
+  GAME_KEY_CRAFT,
+  GAME_KEY_TORCH,
+  GAME_KEY_PROFILER,
+  GAME_KEY_TRACE,
+  GAME_KEY_COUNT,
+} GameKey;
 
-  Rectangle controlsMenuRect;
-  Color controlsMenuRectColor;
-  Vector2 controlsMenuTextPosition;
+/*
+  Everything the game reads from the outside world in one frame.
+  Update code only looks at this snapshot, never at raylib input directly,
+  so a session can be recorded and replayed frame for frame.
+  Only 4 byte fields so it can be written to a file as is.
+*/
+typedef struct InputState
+{
+  float frameTime;
+  Vector2 mousePosition;
+  Vector2i screenSize;
+  unsigned int keysDown;      // 1 << GameKey
+  unsigned int keysPressed;
+  unsigned int mouseDown;     // 1 << MOUSE_BUTTON_*
+  unsigned int mousePressed;
+} InputState;
 
-  Rectangle goBackToMainMenuRect;
-  Color goBackToMainMenuRectColor;
-  Vector2 goBackToMainMenuTextPosition;
-} OptionsMenu;
+/*
+  Replay file, this header and then one InputState per frame.
+  Menu text sizes come from the font on the GPU so they're stored too,
+  a headless replay lays the menus out exactly like the recorded session.
+  The run seed makes the replay climb the same floors.
+*/
+typedef struct ReplayFileHeader
+{
+  char magic[4];
+  int version;
+  int inputStateSize;
+  int textCount;
+  int language;
+  unsigned int seed;
+  Vector2 textSizes[TEXT_COUNT];
+} ReplayFileHeader;
 
-typedef struct GameMapTile
+typedef struct InputReplay
 {
-  int type;
-  Rectangle tileRect;
-  Color tileColor;
-} GameMapTile;
+  FILE* recordFile;           // NULL unless --record
+  unsigned char* data;        // whole replay file, NULL unless --replay
+  int frameCount;
+  int frame;
+  clock_t startTime;
+} InputReplay;
 
 typedef struct GameState
 {
@@ -85,80 +353,263 @@ typedef struct GameState
   Vector2 previousMousePosition;
   Vector2 mousePosition;
   
-  MainMenu mainMenu;
-  OptionsMenu optionsMenu;
-  ControlsMenu controlsMenu;
+  Ui ui;
+  TextCache text;           // glyph atlases and cached runs, the ui draws its labels with it
+  int mainMenu;             // root widgets in ui
+  int optionsMenu;
+  int controlsMenu;
   GameSettings gameSettings;
-  GameMapTile** gameMap;
+  GameMap gameMap;
+  RecipeBook recipeBook;
+  EntityStore entities;     // positions and sizes are in tiles
+
+  /*
+    Floors above the first are generated from the run seed, the next one
+    as a job into floorTiles while this one is played
+  */
+  FloorJob nextFloor;
+  JobCounter nextFloorJob;
+  int* floorTiles;          // FLOOR_MAX_SIZE * FLOOR_MAX_SIZE
+  unsigned int runSeed;
+  int floor;                // 0 is gameMap.csv
+  int floorLoading;         // next view chunk a new floor's preload bakes, -1 when it's done
+
+  /*
+    The simulation advances in fixed SIMULATION_STEP steps no matter the frame rate,
+    rendering draws between the last two steps by simulationAlpha
+  */
+  InputState input;
+  InputReplay replay;
+  bool headless;              // no window, nothing touches the GPU
+  bool profilerVisible;
+  Vector2 textSizes[TEXT_COUNT]; // gameText measured at MENU_FONT_SIZE
+
+  float simulationAccumulator;
+  float simulationAlpha;
+  unsigned long simulationSteps;
   
-  bool mainMenuActive;
-  bool optionsMenuActive;
-  bool controlsMenuActive;
-  bool craftingInventoryActive;
-  bool inventoryActive;
-  bool gameActive;
+  SceneStack scenes;
+  bool mouseHandled;        // a scene above already took this frame's click
+
+  JobSystem jobs;           // workers for what would stall a frame, atlas pngs and floors
+  AssetManager assets;
+  AssetHandle sceneAtlases[SCENE_COUNT];
+  bool sceneAtlasHeld[SCENE_COUNT];   // held even if the atlas failed to load, so it's tried once
   
-  const char* gameText[9];
+  /*
+    gameText points into the string tables, a language's table is only
+    loaded the first time it's used. English is always loaded, it's the fallback
+  */
+  const char* gameText[TEXT_COUNT];
+  Language language;
+  StringTable strings[LANGUAGE_COUNT];
+  MappedFile stringFiles[LANGUAGE_COUNT];
+  bool stringsLoaded[LANGUAGE_COUNT];   // load was tried, the table stays empty if it failed
 } GameState;
 
 /* TYPES */
-typedef enum TextNames
-{
-  START_GAME,
-  OPTIONS,
-  EXIT_GAME,
-  SOUND,
-  CONTROLS,
-  MAIN_MENU,
-  INVENTORY,
-  CRAFTING,
-  MAP,
-} TextNames;
+
+typedef enum ItemId
+{
+  ITEM_NONE,
+  ITEM_SHADOW_ESSENCE,
+  ITEM_MERCURY,
+  ITEM_SULFUR,
+  ITEM_SALT,
+  ITEM_LEAD,
+  ITEM_GOLD,
+  ITEM_WRAITH_DUST,
+  ITEM_SHADE_CORE,
+  ITEM_ELIXIR,
+  ITEM_SHADOW_BOLT,
+  ITEM_SHADE,
+  ITEM_COUNT,
+} ItemId;
 
 typedef struct Item
 {
   //const char* name;
+  int id;
   Rectangle rect;
-  Texture2D texture;
+  uint64_t sprite;          // AssetNameKey of "item<id>"
 } Item;
 
+DEFINE_SMALL_ARRAY(ItemList, Item, MAX_INVENTORY_ITEMS)
+
 typedef struct Inventory
 {
   Rectangle rect;
   Rectangle dragRect;
-  Texture2D texture;
-  Item* items;
+  uint64_t sprite;          // panel sprite, a plain rectangle until the atlas has it
+  ItemList items;            // the grid has MAX_INVENTORY_ITEMS slots, they all fit inline
   bool dragging;
+  Vector2 dragOffset; // mouse position relative to rect when the drag started
 } Inventory;
 
+/* Kinds are stored per entity, systems switch on them instead of on struct types */
+typedef enum EntityKind
+{
+  ENTITY_PLAYER,
+  ENTITY_SHADE,
+  ENTITY_WRAITH,
+  ENTITY_SHADOW_MONSTER,
+  ENTITY_KIND_COUNT,
+} EntityKind;
+
+/* Everything the player has in the world is in gameState->entities, this is just what isn't */
 typedef struct Player
 {
-  Vector2 size;
-  Texture2D texture;
+  Entity entity;
   Inventory* inventory;
   Inventory* craftingInventory;
-  int recentInventoryOpened;
 } Player;
 
 
+/* DATA */
+static const Recipe recipeTable[] = {
+  {{ITEM_LEAD, ITEM_MERCURY, ITEM_SULFUR},               3, ITEM_GOLD},
+  {{ITEM_MERCURY, ITEM_SALT, ITEM_SULFUR},               3, ITEM_ELIXIR},
+  {{ITEM_SHADOW_ESSENCE, ITEM_SHADOW_ESSENCE, ITEM_SALT}, 3, ITEM_SHADOW_BOLT},
+  {{ITEM_WRAITH_DUST, ITEM_SHADOW_ESSENCE},              2, ITEM_SHADE_CORE},
+  {{ITEM_SHADE_CORE, ITEM_SHADOW_ESSENCE, ITEM_MERCURY}, 3, ITEM_SHADE},
+};
+
+/* Two raylib keys per action, KEY_NULL when there's only one */
+static const int gameKeyBindings[GAME_KEY_COUNT][2] = {
+  [GAME_KEY_LEFT]      = {KEY_A, KEY_LEFT},
+  [GAME_KEY_RIGHT]     = {KEY_D, KEY_RIGHT},
+  [GAME_KEY_UP]        = {KEY_W, KEY_UP},
+  [GAME_KEY_DOWN]      = {KEY_S, KEY_DOWN},
+  [GAME_KEY_INVENTORY] = {KEY_I, KEY_NULL},
+  [GAME_KEY_CRAFTING]  = {KEY_C, KEY_NULL},
+  [GAME_KEY_CRAFT]     = {KEY_ENTER, KEY_NULL},
+  [GAME_KEY_TORCH]     = {KEY_E, KEY_NULL},
+  [GAME_KEY_PROFILER]  = {KEY_F3, KEY_NULL},
+  [GAME_KEY_TRACE]     = {KEY_F4, KEY_NULL},
+};
+
+static const TileProperties tileProperties[TILE_TYPE_COUNT] = {
+  [TILE_FLOOR] = {false, false, 0, 0},
+  [TILE_WALL]  = {true,  true,  0, 0},
+  [TILE_TORCH] = {true,  true,  6, 220},
+  [TILE_STAIRS] = {false, false, 0, 0},
+  [TILE_TORCH_OUT] = {true, true, 0, 0},
+};
+
+/* String tables are TEXT_DIRECTORY + code + ".strings" */
+static const char* languageCodes[LANGUAGE_COUNT] = {"en", "es"};
+
+/* Placeholder colors until entities have textures, indexed by EntityKind */
+static const Color entityKindColors[ENTITY_KIND_COUNT] = {PURPLE, DARKGRAY, SKYBLUE, BLACK};
+
 /* OBJECTS */
 GameState* gameState;
 Player* player;
 
+/*
+  All game memory is one allocation made at startup.
+  permanentArena - lives as long as the game
+  levelArena     - reset whenever a new map/floor is loaded
+  frameArena     - scratch memory for one frame, reset at the top of UpdateGame,
+                   anything update/render needs temporarily comes from here
+                   instead of malloc/free
+*/
+void* gameMemory;
+Arena permanentArena;
+Arena levelArena;
+Arena frameArena;
+
+/* Scope timings and counters for the F3 overlay and the Chrome trace export (F4, --trace FILE) */
+Profiler profiler;
+
 
 /* INITIALIZATION */
 void AllocateGame();
 void InitGame(bool resettingSizes);
 void InitGameMap(bool resettingSizes);
+void InitGameMapView(GameMap* map, bool newMap);
+void RequestNextFloor();
+void EnterNextFloor();
 void CreatePlayer(bool resettingSize);
+Entity SpawnEntity(EntityKind kind, Vector2 position, Vector2 size, float health);
+void InitRecipeBook(RecipeBook* book);
 
 /* GENERAL FUNCIONS THAT CONTROL THE FLOW OF THE GAME */
 void UnloadGame();
 void RenderGame();
 void UpdateGame();
+void AdvanceSimulation(float frameTime);
+void SimulateGame(float deltaTime);
+void RunSimulation(int steps);
+
+/* INPUT */
+bool PollInput();
+bool InputKeyDown(GameKey key);
+bool InputKeyPressed(GameKey key);
+bool InputMouseDown(int button);
+bool InputMousePressed(int button);
+bool StartRecording(const char* path);
+bool LoadReplay(const char* path);
+void FinishReplay();
+void MeasureGameTexts();
+bool LoadLanguage(Language language);
+void SetGameLanguage(Language language);
+int FindLanguage(const char* code);
+const char* GameString(TextNames id);
+void LoadGameFonts();
+Vector2 MeasureMenuText(const char* text, float fontSize);
+void ShowMenu(int menu);
+uint64_t GameStateChecksum();
+
+/* SCENES */
+void PushScene(SceneId scene);
+void SetScene(SceneId scene);
+void PopScene();
+void RemoveScene(SceneId scene);
+void RaiseScene(SceneId scene);
+bool SceneInStack(SceneId scene);
+int FindScene(SceneId scene);
+void EnterScene(SceneId scene);
+void ExitScene(int index);
+void ClearScenes();
+void AcquireSceneAtlas(SceneId scene);
+void ReleaseSceneAtlas(SceneId scene);
+int FirstVisibleScene();
+void ToggleOverlay(SceneId scene);
+void ApplySceneRequests();
+void UpdateScenes();
+void RenderScenes();
+bool PreloadGameScene(int* progress);
+void UpdateGameScene();
+void ExitGameScene();
+void ExitInventory();
+void ExitCraftingScene();
 
 /* UTILITY */
-void LoadCSVGameMap(const char *path, GameMapTile** mapBuffer);
+int FindRecipe(RecipeBook* book, const int* itemIds, int itemCount);
+int FindRecipeMaking(RecipeBook* book, int resultId);
+bool AddInventoryItem(Inventory* inventory, int itemId);
+void DragInventory(Inventory* inventory);
+const char* FrameTextFormat(const char* format, ...);
+void CountFrameAllocations();
+void WriteProfilerTrace(const char* path);
+void AllocateGameMap(GameMap* map, int width, int height);
+void UnloadGameMap(GameMap* map);
+void ResetGameMapChunks(GameMap* map);
+int FindGameMapChunk(GameMap* map, int chunkX, int chunkY);
+int LoadGameMapChunk(GameMap* map, int chunkX, int chunkY);
+void BuildGameMapTiles(GameMap* map);
+void UpdateGameMapLight(GameMap* map);
+void SetGameMapTile(GameMap* map, int tile, int type);
+void ToggleTorchNear(GameMap* map, int x, int y);
+Rectangle GetGameMapTileRect(GameMap* map, int tile);
+bool GameMapBoxSolid(GameMap* map, float x, float y, float width, float height);
+bool OpenMappedFile(const char* path, MappedFile* file);
+void CloseMappedFile(MappedFile* file);
+bool LoadGameMap(const char* csvPath, GameMap* map);
+bool LoadBinaryGameMap(const char* path, GameMap* map);
+bool SaveBinaryGameMap(const char* path, GameMap* map);
+bool LoadCSVGameMap(const char* path, GameMap* map);
 
 /* UPDATE FUNCTIONS */
 void UpdateScreenSize();
@@ -168,6 +619,10 @@ void UpdateControlsMenu();
 void UpdateCraftingScene();
 void UpdateInventory();
 void UpdateGameMap();
+void UpdateGameMapView(GameMap* map);
+void UpdatePlayer();
+void UpdateShadowMonsters();
+void UpdateEntities(float deltaTime);
   
 /* RENDER FUNCTIONS */
 void RenderMainMenu();
@@ -175,17 +630,86 @@ void RenderOptionsMenu();
 void RenderControlsMenu();
 void RenderCraftingScene();
 void RenderInventory();
+void RenderInventoryItems(Inventory* inventory);
+Rectangle GetInventorySlotRect(Inventory* inventory, int slot);
 void RenderGameMap();
+void RenderEntities();
+void RenderProfiler();
+
+/* SCENE TABLE */
+static const Scene sceneTable[SCENE_COUNT] = {
+  [SCENE_MAIN_MENU]     = {"MainMenu",     true,  NULL, NULL,              UpdateMainMenu,      RenderMainMenu,      NULL,             NULL},
+  [SCENE_OPTIONS_MENU]  = {"OptionsMenu",  true,  NULL, NULL,              UpdateOptionsMenu,   RenderOptionsMenu,   NULL,             NULL},
+  [SCENE_CONTROLS_MENU] = {"ControlsMenu", true,  NULL, NULL,              UpdateControlsMenu,  RenderControlsMenu,  NULL,             NULL},
+  [SCENE_GAME]          = {"Game",         true,  NULL, ExitGameScene,     UpdateGameScene,     RenderGameMap,       PreloadGameScene, "world"},
+  [SCENE_INVENTORY]     = {"Inventory",    false, NULL, ExitInventory,     UpdateInventory,     RenderInventory,     NULL,             "items"},
+  [SCENE_CRAFTING]      = {"Crafting",     false, NULL, ExitCraftingScene, UpdateCraftingScene, RenderCraftingScene, NULL,             "items"},
+};
 
 int
-main()
+main(int argc, char** argv)
 {
   printf("Game Start/n");
 
   AllocateGame();
+
+  /*
+    --simulate N     runs N simulation steps as fast as possible, no window, no rendering
+    --record FILE    saves every frame's input to FILE
+    --replay FILE    plays FILE back instead of reading input, exits when it runs out
+    --headless       with --replay, no window and no rendering, prints frames/sec and a checksum
+    --trace FILE     writes the profiler's Chrome trace to FILE on exit
+    --language CODE  menu text language (en, es), a replay uses the one it was recorded in
+    --seed N         run seed the floors are generated from, a replay uses the one it was recorded with
+  */
+  const char* recordPath = NULL;
+  const char* replayPath = NULL;
+  const char* tracePath = NULL;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--simulate") == 0 && i + 1 < argc) {
+      RunSimulation(atoi(argv[i + 1]));
+      UnloadGame();
+      return 0;
+    }
+    else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      recordPath = argv[++i];
+    }
+    else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+      replayPath = argv[++i];
+    }
+    else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+      tracePath = argv[++i];
+    }
+    else if (strcmp(argv[i], "--headless") == 0) {
+      gameState->headless = true;
+    }
+    else if (strcmp(argv[i], "--language") == 0 && i + 1 < argc) {
+      int language = FindLanguage(argv[++i]);
+      if (language == -1) {
+        printf("%s: unknown language, using %s.\n", argv[i], languageCodes[gameState->language]);
+      } else {
+        SetGameLanguage((Language)language);
+      }
+    }
+    else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      gameState->runSeed = (unsigned int)strtoul(argv[++i], NULL, 10);
+    }
+  }
+  /* Without a window only sprite tables load, no textures */
+  gameState->assets.loadTextures = !gameState->headless;
+  if (gameState->headless && !replayPath) {
+    printf("--headless needs a --replay file to play.\n");
+    UnloadGame();
+    return 1;
+  }
+  if (replayPath && !LoadReplay(replayPath)) {
+    UnloadGame();
+    return 1;
+  }
+  
   /*
     Get Screen Size from browser first, this is necessary to scale game
-    on browser properly
+    on browser properly. A replay starts at the size it was recorded at.
   */
 #if defined (PLATFORM_WEB)
   gameState->screenSize.x = CanvasGetWidth();
@@ -194,22 +718,58 @@ main()
   gameState->screenSize.x = 1920;
   gameState->screenSize.y = 1080;
 #endif
+  if (gameState->replay.data && gameState->replay.frameCount > 0) {
+    InputState first;
+    memcpy(&first, gameState->replay.data + sizeof(ReplayFileHeader), sizeof(InputState));
+    gameState->screenSize = first.screenSize;
+  }
   
   /* Initialize Game Data - Raylib First! */
-  InitWindow(gameState->screenSize.x, gameState->screenSize.y, "Game Jam");
-  SetTargetFPS(60);
+  if (!gameState->headless) {
+    InitWindow(gameState->screenSize.x, gameState->screenSize.y, "Game Jam");
+    SetTargetFPS(60);
+    LoadGameFonts();
+  }
+  if (!gameState->replay.data) {
+    MeasureGameTexts();
+  }
+  if (recordPath && !StartRecording(recordPath)) {
+    UnloadGame();
+    return 1;
+  }
 
   InitGame(false);
   InitGameMap(false);
   CreatePlayer(false);
+  SetScene(SCENE_MAIN_MENU);
+  ApplySceneRequests();
   
-  while(!WindowShouldClose() && gameState->running) {
-    UpdateGame();
-    RenderGame();
+  gameState->replay.startTime = clock();
+  while (gameState->running) {
+    if (!gameState->headless && WindowShouldClose()) {
+      break;
+    }
+    ProfilerFrameBegin(&profiler);
+    if (!PollInput()) {
+      break; // replay ran out
+    }
+    ProfileCall(&profiler, UpdateGame());
+    if (!gameState->headless) {
+      ProfileCall(&profiler, RenderGame());
+    }
+    CountFrameAllocations();
+    ProfilerFrameEnd(&profiler);
   }
 
+  FinishReplay();
+  if (tracePath) {
+    WriteProfilerTrace(tracePath);
+  }
+  bool headless = gameState->headless;
   UnloadGame();
-  CloseWindow();
+  if (!headless) {
+    CloseWindow();
+  }
   
   return 0;
 }
@@ -217,92 +777,130 @@ main()
 void
 AllocateGame()
 {
-  /* ALLOCATTE MEMORY FOR ALL POINTERS FIRST */
-  gameState = malloc(sizeof(GameState));
-  if (!gameState) {
+  /* ONE ALLOCATION FOR THE WHOLE GAME, EVERYTHING ELSE COMES FROM THE ARENAS */
+  gameMemory = malloc(GAME_PERMANENT_MEMORY_SIZE + GAME_LEVEL_MEMORY_SIZE + GAME_FRAME_MEMORY_SIZE);
+  if (!gameMemory) {
     // failure - exit game
-#ifdef DEBUG
+    printf("Failed to allocate game memory.\n");
+    exit(1);
+  }
+  ArenaInit(&permanentArena, gameMemory, GAME_PERMANENT_MEMORY_SIZE);
+  ArenaInit(&levelArena, (char*)gameMemory + GAME_PERMANENT_MEMORY_SIZE, GAME_LEVEL_MEMORY_SIZE);
+  ArenaInit(&frameArena, (char*)gameMemory + GAME_PERMANENT_MEMORY_SIZE + GAME_LEVEL_MEMORY_SIZE, GAME_FRAME_MEMORY_SIZE);
+  
+  gameState = ArenaPushStruct(&permanentArena, GameState);
+  if (!gameState) {
     printf("Failed to allocate GameState memory.\n");
-#endif
     exit(1);
   }
   
-  gameState->gameText[START_GAME] = "Start Game";
-  gameState->gameText[OPTIONS] = "Options";
-  gameState->gameText[EXIT_GAME] = "Exit Game";
-  gameState->gameText[SOUND] = "Sound";
-  gameState->gameText[CONTROLS] = "Controls";
-  gameState->gameText[MAIN_MENU] = "Main Menu";
-  gameState->gameText[INVENTORY] = "Inventory";
-  gameState->gameText[CRAFTING] = "Crafting";
-  gameState->gameText[MAP] = "Map";
+  memset(gameState->strings, 0, sizeof(gameState->strings));
+  memset(gameState->stringFiles, 0, sizeof(gameState->stringFiles));
+  memset(gameState->stringsLoaded, 0, sizeof(gameState->stringsLoaded));
+  SetGameLanguage(LANGUAGE_EN);
   
   gameState->running = true;
   gameState->screenSize = (Vector2i){1920,1080};
-  gameState->mainMenuActive = true;
-  gameState->optionsMenuActive = false;
-  gameState->controlsMenuActive = false;
-  gameState->gameActive = false;
-  gameState->inventoryActive = false;
-  gameState->craftingInventoryActive = false;
+  gameState->scenes.count = 0;
+  gameState->scenes.loading = SCENE_NONE;
+  SceneRequestRingInit(&gameState->scenes.requests);
   
   /* Game Settings */
   gameState->gameSettings.soundOn = true;
   
-  player = malloc(sizeof(Player));
+  player = ArenaPushStruct(&permanentArena, Player);
   if (!player) {
     // failure - exit game
-#ifdef DEBUG    
-    printf("Failed to allocated Player memory.\n");
-#endif
+    printf("Failed to allocate Player memory.\n");
     exit(1);
   }
-  player->inventory = malloc(sizeof(Inventory));
-  if (!player->inventory) {
-#ifdef DEBUG
-    printf("Failed to allocated player inventory memory.\n");
+  player->inventory = ArenaPushStruct(&permanentArena, Inventory);
+  player->craftingInventory = ArenaPushStruct(&permanentArena, Inventory);
+  if (!player->inventory || !player->craftingInventory) {
+    printf("Failed to allocate player inventory memory.\n");
     exit(1);
-#endif
   }
-  player->inventory->items = NULL;
-  player->craftingInventory = malloc(sizeof(Inventory));
-  if (!player->craftingInventory) {
-#ifdef DEBUG
-    printf("Failed to allocate player crafting inventory memory.\n");
+  ItemListInit(&player->inventory->items);
+  ItemListInit(&player->craftingInventory->items);
+
+  void* entityMemory = ArenaPush(&permanentArena, EntityStoreMemorySize(MAX_ENTITIES), ARENA_DEFAULT_ALIGN);
+  if (!entityMemory) {
+    printf("Failed to allocate entity memory.\n");
     exit(1);
-#endif
   }
-  player->craftingInventory->items = NULL;
-  player->inventory->items = malloc(sizeof(Item)*MAX_INVENTORY_ITEMS);
-  if (!player->inventory->items) {
-#ifdef DEBUG
-    printf("Failed to allocated player inventory items memory.\n");
+  EntityStoreInit(&gameState->entities, entityMemory, MAX_ENTITIES);
+
+  void* uiMemory = ArenaPush(&permanentArena, UiMemorySize, ARENA_DEFAULT_ALIGN);
+  if (!uiMemory) {
+    printf("Failed to allocate UI memory.\n");
     exit(1);
-#endif
   }
-  player->craftingInventory->items = malloc(sizeof(Item)*MAX_INVENTORY_ITEMS);
-  if (!player->craftingInventory->items) {
-#ifdef DEBUG
-    printf("Failed to allocate player crafting inventory items memory.\n");
+  UiInit(&gameState->ui, uiMemory, MeasureMenuText);
+
+  void* textMemory = ArenaPush(&permanentArena, TextCacheMemorySize, ARENA_DEFAULT_ALIGN);
+  if (!textMemory) {
+    printf("Failed to allocate text cache memory.\n");
     exit(1);
-#endif
   }
-  
-  gameState->gameMap = malloc(sizeof(GameMapTile*)*10);
-  if (!gameState->gameMap) {
-#ifdef DEBUG
-    printf("Failed to allocate inital game map memory.\n");
+  TextCacheInit(&gameState->text, textMemory);
+  gameState->ui.text = &gameState->text;
+
+  void* assetMemory = ArenaPush(&permanentArena, AssetManagerMemorySize, ARENA_DEFAULT_ALIGN);
+  if (!assetMemory) {
+    printf("Failed to allocate asset manager memory.\n");
     exit(1);
-#endif
   }
-  for (int i = 0; i < 10; i++) {
-    gameState->gameMap[i] = malloc(sizeof(GameMapTile) * 10);
-    if (!gameState->gameMap[i]) {
-#ifdef DEBUG
-      printf("Failed to allocate map row memory.\n");
-      exit(1);
-#endif
+  if (JobSystemStart(&gameState->jobs, JOB_WORKER_THREADS) == 0) {
+    printf("No job threads, jobs run as they're started.\n");
+  }
+  AssetManagerInit(&gameState->assets, assetMemory, ASSET_DIRECTORY, true);
+  gameState->assets.jobs = &gameState->jobs;
+  memset(gameState->sceneAtlases, 0, sizeof(gameState->sceneAtlases));
+  memset(gameState->sceneAtlasHeld, 0, sizeof(gameState->sceneAtlasHeld));
+
+  ProfileEvent* traceEvents = ArenaPushArray(&permanentArena, ProfileEvent, PROFILER_TRACE_EVENTS);
+  ProfilerInit(&profiler, traceEvents, traceEvents ? PROFILER_TRACE_EVENTS : 0);
+
+  InitRecipeBook(&gameState->recipeBook);
+
+  /* Floors are generated into permanent memory, a new map copies out of it */
+  gameState->floorTiles = ArenaPushArray(&permanentArena, int, FLOOR_MAX_SIZE * FLOOR_MAX_SIZE);
+  if (!gameState->floorTiles) {
+    printf("Failed to allocate floor memory.\n");
+    exit(1);
+  }
+  gameState->runSeed = (unsigned int)time(NULL);
+  gameState->floor = 0;
+  gameState->floorLoading = -1;
+
+  /* Map memory comes from levelArena once the map dimensions are known (LoadGameMap) */
+}
+
+void
+InitRecipeBook(RecipeBook* book)
+{
+  int recipeCount = (int)(sizeof(recipeTable) / sizeof(recipeTable[0]));
+  void* byIngredientsMemory = ArenaPush(&permanentArena, HashMapMemorySize(RECIPE_MAP_CAPACITY), ARENA_DEFAULT_ALIGN);
+  void* byResultMemory = ArenaPush(&permanentArena, SortedIndexMemorySize(recipeCount), ARENA_DEFAULT_ALIGN);
+  if (!byIngredientsMemory || !byResultMemory || recipeCount * 10 > RECIPE_MAP_CAPACITY * 7) {
+    printf("Failed to allocate recipe book memory.\n");
+    exit(1);
+  }
+  
+  book->recipes = recipeTable;
+  book->recipeCount = recipeCount;
+  HashMapInit(&book->byIngredients, byIngredientsMemory, RECIPE_MAP_CAPACITY);
+  SortedIndexInit(&book->byResult, byResultMemory, recipeCount);
+
+  for (int i = 0; i < recipeCount; i++) {
+    const Recipe* recipe = &recipeTable[i];
+    uint64_t key = HashMultiset(recipe->ingredients, recipe->ingredientCount);
+    if (HashMapGet(&book->byIngredients, key) != HASHMAP_NOT_FOUND) {
+      printf("Recipe %d uses the same ingredients as another recipe, ignoring it.\n", i);
+      continue;
     }
+    HashMapPut(&book->byIngredients, key, (uint32_t)i);
+    SortedIndexInsert(&book->byResult, (uint64_t)recipe->result, (uint32_t)i);
   }
 }
 
@@ -317,65 +915,26 @@ InitGame(bool resettingSizes)
   /*   return; */
   /* } */
   
-  /* where all rects start from */
-  float startX = gameState->screenSize.x/2.f;
-  float startY = gameState->screenSize.y/4.f;
-  
-  /* Main Menu Stuff */
-  if (!resettingSizes) {
-    gameState->mainMenu.fontSize = 40.f;
-    gameState->mainMenu.startGameRectColor =       RAYWHITE;
-    gameState->mainMenu.gotoOptionsMenuRectColor = RAYWHITE;
-    gameState->mainMenu.exitGameRectColor =        RAYWHITE;
-  }
-  
-  Vector2 size1 = MeasureTextEx(GetFontDefault(), gameState->gameText[START_GAME], 40.f, 1.f);
-  Vector2 size2 = MeasureTextEx(GetFontDefault(), gameState->gameText[OPTIONS],    40.f, 1.f);
-  Vector2 size3 = MeasureTextEx(GetFontDefault(), gameState->gameText[EXIT_GAME],  40.f, 1.f);
-  
-  gameState->mainMenu.startGameRect =       (Rectangle){startX - (size1.x/2.f) - 10.f,
-						        startY - (size1.y/2.f) - 10.f,
-						        size1.x + 20.f, size1.y + 20.f};
-  gameState->mainMenu.gotoOptionsMenuRect = (Rectangle){startX - (size2.x/2.f) - 10.f,
-						       (startY - (size2.y/2.f) - 10.f) + 100.f,
-							size2.x + 20.f, size2.y + 20.f};
-  gameState->mainMenu.exitGameRect =        (Rectangle){startX - (size3.x/2.f) - 10.f,
-						       (startY - (size3.y/2.f) - 10.f) + 200.f,
-						        size3.x + 20.f, size3.y + 20.f};
-  
-  gameState->mainMenu.startGameTextPosition =       (Vector2){gameState->mainMenu.startGameRect.x + 10.f,       gameState->mainMenu.startGameRect.y + 10.f};
-  gameState->mainMenu.gotoOptionsMenuTextPosition = (Vector2){gameState->mainMenu.gotoOptionsMenuRect.x + 10.f, gameState->mainMenu.gotoOptionsMenuRect.y + 10.f};
-  gameState->mainMenu.exitGameTextPosition =        (Vector2){gameState->mainMenu.exitGameRect.x + 10.f,        gameState->mainMenu.exitGameRect.y + 10.f};
-  
-  /* Options Menu STuff */
+  /* Menus are declared once, after that only a resize gets them laid out again */
+  Ui* ui = &gameState->ui;
   if (!resettingSizes) {
-    gameState->optionsMenu.fontSize = 40.f;
-    gameState->optionsMenu.soundToggleRectColor =      RAYWHITE;
-    gameState->optionsMenu.controlsMenuRectColor =     RAYWHITE;
-    gameState->optionsMenu.goBackToMainMenuRectColor = RAYWHITE;
-  }
-  
-  size1 = MeasureTextEx(GetFontDefault(), gameState->gameText[SOUND], 40.f, 1.f);
-  size2 = MeasureTextEx(GetFontDefault(), gameState->gameText[CONTROLS], 40.f, 1.f);
-  size3 = MeasureTextEx(GetFontDefault(), gameState->gameText[MAIN_MENU], 40.f, 1.f);
-  
-  gameState->optionsMenu.soundToggleRect =     (Rectangle){startX - (size1.x/2.f) - 10.f,
-						 	   startY - (size1.y/2.f) - 10.f,
-							   size1.x + 20.f, size1.y + 20.f};
-  gameState->optionsMenu.controlsMenuRect =    (Rectangle){startX - (size2.x/2.f) - 10.f,
-						           (startY - (size2.y/2.f) - 10.f) + 100.f,
-						            size2.x + 20.f, size2.y + 20.f};
-  gameState->optionsMenu.goBackToMainMenuRect = (Rectangle){startX - (size3.x/2.f) - 10.f,
-						           (startY - (size3.y/2.f) - 10.f) + 200.f,
-						            size3.x + 20.f, size3.y + 20.f};
+    gameState->mainMenu = UiAddStack(ui, (Vector2){0.5f, 0.25f}, 100.f);
+    UiAddButton(ui, gameState->mainMenu, gameState->gameText[START_GAME], MENU_FONT_SIZE, MENU_ACTION_START_GAME);
+    UiAddButton(ui, gameState->mainMenu, gameState->gameText[OPTIONS],    MENU_FONT_SIZE, MENU_ACTION_OPTIONS);
+    UiAddButton(ui, gameState->mainMenu, gameState->gameText[EXIT_GAME],  MENU_FONT_SIZE, MENU_ACTION_EXIT_GAME);
 
-  gameState->optionsMenu.soundToggleTextPosition =      (Vector2){gameState->optionsMenu.soundToggleRect.x + 10.f,      gameState->optionsMenu.soundToggleRect.y + 10.f};
-  gameState->optionsMenu.controlsMenuTextPosition =     (Vector2){gameState->optionsMenu.controlsMenuRect.x + 10.f,     gameState->optionsMenu.controlsMenuRect.y + 10.f};
-  gameState->optionsMenu.goBackToMainMenuTextPosition = (Vector2){gameState->optionsMenu.goBackToMainMenuRect.x + 10.f, gameState->optionsMenu.goBackToMainMenuRect.y + 10.f};
+    gameState->optionsMenu = UiAddStack(ui, (Vector2){0.5f, 0.25f}, 100.f);
+    UiAddButton(ui, gameState->optionsMenu, gameState->gameText[SOUND],     MENU_FONT_SIZE, MENU_ACTION_TOGGLE_SOUND);
+    UiAddButton(ui, gameState->optionsMenu, gameState->gameText[CONTROLS],  MENU_FONT_SIZE, MENU_ACTION_CONTROLS);
+    UiAddButton(ui, gameState->optionsMenu, gameState->gameText[MAIN_MENU], MENU_FONT_SIZE, MENU_ACTION_MAIN_MENU);
 
+    gameState->controlsMenu = UiAddStack(ui, (Vector2){0.5f, 0.25f}, 100.f);
+    UiAddButton(ui, gameState->controlsMenu, gameState->gameText[OPTIONS], MENU_FONT_SIZE, MENU_ACTION_OPTIONS);
+  }
+  UiResize(ui, (Vector2){(float)gameState->screenSize.x, (float)gameState->screenSize.y});
 
   /* Initial Mouse Position */
-  gameState->mousePosition = GetMousePosition();
+  gameState->mousePosition = gameState->input.mousePosition;
 }
 
 void
@@ -391,32 +950,121 @@ InitGameMap(bool resettingSize)
   
   if (!resettingSize) {
 #if defined (PLATFORM_WEB)
-    LoadCSVGameMap("gameMap.csv", gameState->gameMap);
+    const char* mapPath = "gameMap.csv";
 #else
-    LoadCSVGameMap("src/gameMap.csv", gameState->gameMap);
-#endif	
+    const char* mapPath = "src/gameMap.csv";
+#endif
+    if (!LoadGameMap(mapPath, &gameState->gameMap)) {
+      printf("Failed to load game map.\n");
+      exit(1);
+    }
+    BuildGameMapTiles(&gameState->gameMap);
+
+    /* The climb starts over, floor 1 generates while floor 0 is played */
+    gameState->floor = 0;
+    gameState->floorLoading = -1;
+    RequestNextFloor();
+  }
+  InitGameMapView(&gameState->gameMap, !resettingSize);
+}
+
+/* Tile size for the screen, a new map also gets its camera and chunk textures go either way */
+void
+InitGameMapView(GameMap* map, bool newMap)
+{
+  /* Small maps fill the screen, bigger ones scroll with the camera */
+  int viewTilesX = map->width < MAP_VIEW_TILES ? map->width : MAP_VIEW_TILES;
+  int viewTilesY = map->height < MAP_VIEW_TILES ? map->height : MAP_VIEW_TILES;
+  map->tileSize = (Vector2){gameState->screenSize.x / (float)viewTilesX,
+                            gameState->screenSize.y / (float)viewTilesY};
+  map->chunkTexelSize.x = map->tileSize.x < MAP_CHUNK_MAX_TEXELS ? (int)map->tileSize.x : MAP_CHUNK_MAX_TEXELS;
+  map->chunkTexelSize.y = map->tileSize.y < MAP_CHUNK_MAX_TEXELS ? (int)map->tileSize.y : MAP_CHUNK_MAX_TEXELS;
+  
+  if (newMap) {
+    map->camera = (Camera2D){(Vector2){0.f, 0.f}, (Vector2){0.f, 0.f}, 0.f, 1.f};
+  }
+
+  /* Chunk textures depend on the tile size, they get rebuilt as the view needs them */
+  ResetGameMapChunks(map);
+}
+
+/* The floor above this one starts generating, it's usually done long before the stairs are reached */
+void
+RequestNextFloor()
+{
+  /* The job before it writes the same tiles, it's long done unless the climb restarted right away */
+  JobWait(&gameState->jobs, &gameState->nextFloorJob);
+
+  int next = gameState->floor + 1;
+  int size = FLOOR_BASE_SIZE + FLOOR_SIZE_STEP * (next - 1);
+  size = size < FLOOR_MAX_SIZE ? size : FLOOR_MAX_SIZE;
+  uint64_t seed = ((uint64_t)gameState->runSeed << 32) | (uint32_t)next;
+  gameState->nextFloor = (FloorJob){gameState->floorTiles, {0}, size, size, seed};
+  JobRun(&gameState->jobs, FloorGenerateJob, &gameState->nextFloor, &gameState->nextFloorJob);
+}
+
+/*
+  Up the stairs, the generated floor replaces the map and the player starts
+  on it. Everything else on the old floor goes with it. The first view is
+  baked over the next frames like the game scene preload does
+*/
+void
+EnterNextFloor()
+{
+  JobWait(&gameState->jobs, &gameState->nextFloorJob);
+  const FloorLayout* layout = &gameState->nextFloor.layout;
+  if (layout->width == 0) {
+    return;
   }
 
-  // x scale factor 60
-  // y scale factor = 33.47
-  float tileWidth = gameState->screenSize.x / 10.f;
-  float tileHeight = gameState->screenSize.y / 10.f;
-  for (int y = 0; y < 10; y++) {
-    for (int x = 0 ; x < 10; x++) {
-      gameState->gameMap[y][x].tileRect = (Rectangle){x * tileWidth, y*tileHeight,tileWidth, tileHeight};
+  GameMap* map = &gameState->gameMap;
+  AllocateGameMap(map, layout->width, layout->height);
+  memcpy(map->tileTypes, gameState->floorTiles, sizeof(int) * map->tileCount);
+  BuildGameMapTiles(map);
+  InitGameMapView(map, true);
+
+  EntityStore* entities = &gameState->entities;
+  for (int i = entities->count - 1; i >= 0; i--) {
+    if (entities->entities[i] != player->entity) {
+      EntityDestroy(entities, entities->entities[i]);
     }
   }
+  int playerIndex = EntityIndex(entities, player->entity);
+  if (playerIndex != -1) {
+    entities->positionX[playerIndex] = layout->startX + 0.5f - entities->sizeX[playerIndex] / 2.f;
+    entities->positionY[playerIndex] = layout->startY + 0.5f - entities->sizeY[playerIndex] / 2.f;
+    entities->previousX[playerIndex] = entities->positionX[playerIndex];
+    entities->previousY[playerIndex] = entities->positionY[playerIndex];
+  }
+  map->playerLight = LightMapAddLight(&map->light, layout->startX, layout->startY,
+                                      PLAYER_LIGHT_RADIUS, PLAYER_LIGHT_INTENSITY);
+  LightMapSetViewer(&map->light, map->playerLight);
+
+  gameState->floor++;
+  gameState->floorLoading = 0;
+  RequestNextFloor();
 }
 
 void
 CreatePlayer(bool resettingSize)
 {
   if (!resettingSize) {
-    memset(player->inventory->items, 0, MAX_INVENTORY_ITEMS);
-    memset(player->craftingInventory->items, 0, MAX_INVENTORY_ITEMS);
-    player->size = (Vector2){32.f, 32.f};
-    memset(&player->texture, 0, sizeof(Texture2D));
-    player->recentInventoryOpened = 0;
+    ItemListClear(&player->inventory->items);
+    ItemListClear(&player->craftingInventory->items);
+
+    /* Starts in the middle of the map */
+    GameMap* map = &gameState->gameMap;
+    player->entity = SpawnEntity(ENTITY_PLAYER, (Vector2){map->width / 2.f, map->height / 2.f},
+                                 (Vector2){0.5f, 0.5f}, 100.f);
+    if (player->entity == ENTITY_NONE) {
+      printf("Failed to create the player entity.\n");
+      exit(1);
+    }
+
+    /* The player carries a light and sees what it reaches */
+    map->playerLight = LightMapAddLight(&map->light, map->width / 2, map->height / 2,
+                                        PLAYER_LIGHT_RADIUS, PLAYER_LIGHT_INTENSITY);
+    LightMapSetViewer(&map->light, map->playerLight);
   }
 
   player->inventory->rect = (Rectangle){0.f, 10.f, 800.f, 800.f};
@@ -425,6 +1073,8 @@ CreatePlayer(bool resettingSize)
   player->craftingInventory->dragRect = (Rectangle){0.f, 10.f, 800.f, 10.f};
   player->inventory->dragging = false;
   player->craftingInventory->dragging = false;
+  player->inventory->sprite = AssetNameKey("inventory");
+  player->craftingInventory->sprite = AssetNameKey("crafting");
 }
 
 
@@ -433,30 +1083,37 @@ UnloadGame()
 {
 #ifdef DEBUG
   printf("Freeing all memory.\n");
+  printf("Arena high water marks - permanent: %zu, level: %zu, frame: %zu of %d bytes.\n",
+         permanentArena.highWater, levelArena.highWater, frameArena.highWater, GAME_FRAME_MEMORY_SIZE);
 #endif
   
-  free(player);
-  for (int i = 0; i < 10; i++) {
-    free(gameState->gameMap[i]);
+  /* GPU resources first, then the single block all game memory came from */
+  UnloadGameMap(&gameState->gameMap);
+  TextCacheUnload(&gameState->text);
+  AssetManagerUnload(&gameState->assets);
+  for (int i = 0; i < LANGUAGE_COUNT; i++) {
+    CloseMappedFile(&gameState->stringFiles[i]);
   }
-  free(gameState->gameMap);
-  free(gameState);
+  /* Jobs write into game memory, the last ones finish before it goes */
+  JobSystemStop(&gameState->jobs);
+  ItemListFree(&player->inventory->items);
+  ItemListFree(&player->craftingInventory->items);
+  free(gameMemory);
+  gameMemory = NULL;
+  gameState = NULL;
+  player = NULL;
 }
 
 void
 UpdateScreenSize()
 {
-#if defined (PLATFORM_WEB)
-  gameState->screenSize.x = CanvasGetWidth();
-  gameState->screenSize.y = CanvasGetHeight();
-#else
-  gameState->screenSize.x = GetScreenWidth();
-  gameState->screenSize.y = GetScreenHeight();
-#endif
-  if (gameState->screenSize.x != GetScreenWidth() ||
-      gameState->screenSize.y != GetScreenHeight())
-  {
-    SetWindowSize(gameState->screenSize.x, gameState->screenSize.y);
+  /* The size comes in with the input, on web it's the canvas size */
+  Vector2i size = gameState->input.screenSize;
+  if (!gameState->headless && (size.x != GetScreenWidth() || size.y != GetScreenHeight())) {
+    SetWindowSize(size.x, size.y);
+  }
+  if (size.x != gameState->screenSize.x || size.y != gameState->screenSize.y) {
+    gameState->screenSize = size;
     InitGame(true); // true - were resetting the size of all the rects
     InitGameMap(true); // true - were resetting the size of all the rects
   }
@@ -465,321 +1122,1892 @@ UpdateScreenSize()
 void
 UpdateGame()
 {
+  /* Last frame's scratch memory is done with */
+  size_t frameOverflows = ArenaTakeOverflows(&frameArena);
+  if (frameOverflows > 0) {
+    printf("Frame arena overflowed %zu times last frame (%d bytes), raise GAME_FRAME_MEMORY_SIZE.\n",
+           frameOverflows, GAME_FRAME_MEMORY_SIZE);
+  }
+  ArenaReset(&frameArena);
+
+  /* Atlas pngs decoded on the job threads become textures here */
+  AssetUpdate(&gameState->assets);
+  
   UpdateScreenSize();
 
   gameState->previousMousePosition = gameState->mousePosition;
-  gameState->mousePosition = GetMousePosition();
+  gameState->mousePosition = gameState->input.mousePosition;
   
-  if (gameState->gameActive) {
-    UpdateGameMap();
-  }
-  else if (gameState->mainMenuActive) {
-    UpdateMainMenu();
-  }
-  else if (gameState->optionsMenuActive) {
-    UpdateOptionsMenu();
-  }
-  else if (gameState->controlsMenuActive) {
-    UpdateControlsMenu();
-  }
+  gameState->mouseHandled = false;
+  UpdateScenes();
 
-  /* OPEN CRAFTING */
-  if (IsKeyPressed(KEY_I)) {
-    if (gameState->inventoryActive) {
-      gameState->inventoryActive = false;
-    } else {
-      player->recentInventoryOpened = 1;
-      gameState->inventoryActive = true;
-    }
-  }
-  /* OPEN CRAFTING */
-  if (IsKeyPressed(KEY_C)) {
-    if (gameState->craftingInventoryActive) {
-      gameState->craftingInventoryActive = false;
-    } else {
-      player->recentInventoryOpened = 1;
-      gameState->craftingInventoryActive = true;
-    }
-  }
-  /*
-    I want these to be able to run no matter what
-     except for when main,options,controls menus are open
-     not sure how to handle that yet
-  */
-  if (gameState->craftingInventoryActive) {
-    UpdateCraftingScene();
+  /* PROFILER */
+  if (InputKeyPressed(GAME_KEY_PROFILER)) {
+    gameState->profilerVisible = !gameState->profilerVisible;
+    ProfilerResetMax(&profiler);
   }
-  if (gameState->inventoryActive) {
-    UpdateInventory();
+  if (InputKeyPressed(GAME_KEY_TRACE)) {
+    WriteProfilerTrace(PROFILER_TRACE_PATH);
   }
 }
 
+/*
+  Fixed timestep, the frame's time goes into the accumulator and whole steps are taken out.
+  What's left over decides how far between the last two steps rendering is.
+*/
 void
-RenderGame()
+AdvanceSimulation(float frameTime)
 {
-  BeginDrawing();
-  {
-    ClearBackground(RAYWHITE);
-    //DrawRectangle(100, 100, player->size.x, player->size.y, PURPLE);
-    if (gameState->gameActive) {
-      RenderGameMap();
-    }
-    else if (gameState->mainMenuActive) {
-      RenderMainMenu();
-    }
-    else if (gameState->optionsMenuActive) {
-      RenderOptionsMenu();
-    }
-    else if (gameState->controlsMenuActive) {
-      RenderControlsMenu();
-    }
-    /* These are able to run no matter what, same as in UpdateGame function */
-    if (player->recentInventoryOpened == 1) {// crafting inventroy is open
-      if (gameState->inventoryActive) {
-	RenderInventory();
-      }
-      if (gameState->craftingInventoryActive) {
-	RenderCraftingScene();
-      }
-    }
-    else if (player->recentInventoryOpened == 0) { // basic inventory is open
-      if (gameState->craftingInventoryActive) {
-	RenderCraftingScene();
-      }
-      if (gameState->inventoryActive) {
-        RenderInventory();
-      }
-    }
+  gameState->simulationAccumulator += frameTime;
+  
+  int steps = 0;
+  while (gameState->simulationAccumulator >= SIMULATION_STEP && steps < MAX_SIMULATION_STEPS_PER_FRAME) {
+    SimulateGame(SIMULATION_STEP);
+    gameState->simulationAccumulator -= SIMULATION_STEP;
+    steps++;
+  }
+  if (steps == MAX_SIMULATION_STEPS_PER_FRAME && gameState->simulationAccumulator >= SIMULATION_STEP) {
+    gameState->simulationAccumulator = 0.f;
   }
-  EndDrawing();
+  
+  gameState->simulationAlpha = gameState->simulationAccumulator / SIMULATION_STEP;
 }
 
+/* One fixed step of everything that moves, must not depend on the frame rate or on rendering */
 void
-UpdateMainMenu()
+SimulateGame(float deltaTime)
 {
-  gameState->mainMenu.startGameRectColor =       RAYWHITE;
-  gameState->mainMenu.gotoOptionsMenuRectColor = RAYWHITE;
-  gameState->mainMenu.exitGameRectColor =        RAYWHITE;
+  EntityStore* entities = &gameState->entities;
+  memcpy(entities->previousX, entities->positionX, sizeof(float) * entities->count);
+  memcpy(entities->previousY, entities->positionY, sizeof(float) * entities->count);
   
-  if (CheckCollisionPointRec(gameState->mousePosition, gameState->mainMenu.startGameRect)) {
-    gameState->mainMenu.startGameRectColor = BLACK;
-    if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
-      gameState->mainMenuActive = false;
-      gameState->gameActive = true;
-    }
-  }
-  else if (CheckCollisionPointRec(gameState->mousePosition, gameState->mainMenu.gotoOptionsMenuRect)) {
-    gameState->mainMenu.gotoOptionsMenuRectColor = BLACK;
-    if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
-      gameState->mainMenuActive = false;
-      gameState->optionsMenuActive = true;
-    }
-  }
-  else if (CheckCollisionPointRec(gameState->mousePosition, gameState->mainMenu.exitGameRect)) {
-    gameState->mainMenu.exitGameRectColor = BLACK;
-    if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
-      gameState->running = false;
-      gameState->mainMenuActive = false;
-    }
-  }
+  ProfileCall(&profiler, UpdatePlayer());
+  ProfileCall(&profiler, UpdateShadowMonsters());
+  ProfileCall(&profiler, UpdateEntities(deltaTime));
+  gameState->simulationSteps++;
 }
 
+/* Headless run for benchmarks, the map and the player are loaded but nothing touches the GPU */
 void
-RenderMainMenu()
+RunSimulation(int steps)
 {
-  /* ABSOLUTELY CRUCIAL THINGS ARE DRAWN IN CORRECT ORDER */
-  DrawRectangleLinesEx(gameState->mainMenu.startGameRect,       1.f, gameState->mainMenu.startGameRectColor);
-  DrawRectangleLinesEx(gameState->mainMenu.gotoOptionsMenuRect, 1.f, gameState->mainMenu.gotoOptionsMenuRectColor);
-  DrawRectangleLinesEx(gameState->mainMenu.exitGameRect,        1.f, gameState->mainMenu.exitGameRectColor);
-  DrawTextEx(GetFontDefault(), gameState->gameText[START_GAME], gameState->mainMenu.startGameTextPosition,    gameState->mainMenu.fontSize, 1.f, BLACK);
-  DrawTextEx(GetFontDefault(), gameState->gameText[OPTIONS], gameState->mainMenu.gotoOptionsMenuTextPosition, gameState->mainMenu.fontSize, 1.f, BLACK);
-  DrawTextEx(GetFontDefault(), gameState->gameText[EXIT_GAME], gameState->mainMenu.exitGameTextPosition,      gameState->mainMenu.fontSize, 1.f, BLACK);
+  InitGameMap(false);
+  CreatePlayer(false);
+
+  /* Something for the systems to chew on, same wanderers every run */
+  unsigned int seed = 12345;
+  GameMap* map = &gameState->gameMap;
+  for (int i = 0; i < SIMULATE_ENTITY_COUNT; i++) {
+    EntityKind kind = i % 3 == 2 ? ENTITY_SHADOW_MONSTER : i % 3 ? ENTITY_WRAITH : ENTITY_SHADE;
+    seed = seed * 1664525u + 1013904223u;
+    float x = (seed >> 8) / (float)(1 << 24) * map->width;
+    seed = seed * 1664525u + 1013904223u;
+    float y = (seed >> 8) / (float)(1 << 24) * map->height;
+    Entity entity = SpawnEntity(kind, (Vector2){x, y}, (Vector2){0.5f, 0.5f}, 10.f);
+    if (entity == ENTITY_NONE) {
+      break;
+    }
+    int index = EntityIndex(&gameState->entities, entity);
+    gameState->entities.velocityX[index] = (i % 7) - 3.f;
+    gameState->entities.velocityY[index] = (i % 5) - 2.f;
+  }
+
+  clock_t start = clock();
+  for (int i = 0; i < steps; i++) {
+    SimulateGame(SIMULATION_STEP);
+  }
+  double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+  
+  printf("Simulated %d steps (%.1f game seconds) of %d entities in %.3f seconds, %.0f steps/sec.\n",
+         steps, steps * SIMULATION_STEP, gameState->entities.count, seconds,
+         seconds > 0.0 ? steps / seconds : 0.0);
 }
 
-void
-UpdateOptionsMenu()
+/* Fills gameState->input for this frame, false when a replay has no frames left */
+bool
+PollInput()
 {
+  InputReplay* replay = &gameState->replay;
+  InputState* input = &gameState->input;
   
-  gameState->optionsMenu.controlsMenuRectColor =     RAYWHITE;
-  gameState->optionsMenu.soundToggleRectColor =      RAYWHITE;
-  gameState->optionsMenu.goBackToMainMenuRectColor = RAYWHITE;
-
-  if (CheckCollisionPointRec(gameState->mousePosition, gameState->optionsMenu.soundToggleRect)) {
-    gameState->optionsMenu.soundToggleRectColor = BLACK;
-    if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
-      if (gameState->gameSettings.soundOn) {
-	gameState->gameSettings.soundOn = false;
-      } else {
-	gameState->gameSettings.soundOn = true;
-      }
-      printf("Changing sound setting - %d\n", gameState->gameSettings.soundOn);
+  if (replay->data) {
+    if (replay->frame == replay->frameCount) {
+      return false;
     }
+    memcpy(input, replay->data + sizeof(ReplayFileHeader) + sizeof(InputState) * replay->frame, sizeof(InputState));
+    replay->frame++;
+    return true;
   }
-  else if (CheckCollisionPointRec(gameState->mousePosition, gameState->optionsMenu.controlsMenuRect)) {
-    gameState->optionsMenu.controlsMenuRectColor = BLACK;
-    if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
-      gameState->optionsMenuActive = false;
-      gameState->controlsMenuActive = true;
+  
+  memset(input, 0, sizeof(InputState));
+  input->frameTime = GetFrameTime();
+  input->mousePosition = GetMousePosition();
+#if defined (PLATFORM_WEB)
+  input->screenSize = (Vector2i){CanvasGetWidth(), CanvasGetHeight()};
+#else
+  input->screenSize = (Vector2i){GetScreenWidth(), GetScreenHeight()};
+#endif
+  for (int key = 0; key < GAME_KEY_COUNT; key++) {
+    for (int i = 0; i < 2; i++) {
+      int binding = gameKeyBindings[key][i];
+      if (binding == KEY_NULL) {
+        continue;
+      }
+      if (IsKeyDown(binding))    input->keysDown |= 1u << key;
+      if (IsKeyPressed(binding)) input->keysPressed |= 1u << key;
     }
   }
-  else if (CheckCollisionPointRec(gameState->mousePosition, gameState->optionsMenu.goBackToMainMenuRect)) {
-    gameState->optionsMenu.goBackToMainMenuRectColor = BLACK;
-    if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
-      gameState->optionsMenuActive = false;
-      gameState->mainMenuActive = true;
-    }
+  for (int button = MOUSE_BUTTON_LEFT; button <= MOUSE_BUTTON_MIDDLE; button++) {
+    if (IsMouseButtonDown(button))    input->mouseDown |= 1u << button;
+    if (IsMouseButtonPressed(button)) input->mousePressed |= 1u << button;
+  }
+
+  if (replay->recordFile) {
+    fwrite(input, sizeof(InputState), 1, replay->recordFile);
+    replay->frameCount++;
   }
+  return true;
 }
 
-void
-RenderOptionsMenu()
+bool
+InputKeyDown(GameKey key)
 {
-  /* ABSOLUTELY CRUCIAL THINGS ARE DRAWN IN CORRECT ORDER */
-  DrawRectangleLinesEx(gameState->optionsMenu.soundToggleRect,      1.f,  gameState->optionsMenu.soundToggleRectColor);
-  DrawRectangleLinesEx(gameState->optionsMenu.controlsMenuRect,     1.f,  gameState->optionsMenu.controlsMenuRectColor);
-  DrawRectangleLinesEx(gameState->optionsMenu.goBackToMainMenuRect, 1.f,  gameState->optionsMenu.goBackToMainMenuRectColor);
-  DrawTextEx(GetFontDefault(), gameState->gameText[SOUND],     gameState->optionsMenu.soundToggleTextPosition,      gameState->optionsMenu.fontSize, 1.f, BLACK);
-  DrawTextEx(GetFontDefault(), gameState->gameText[CONTROLS],  gameState->optionsMenu.controlsMenuTextPosition,     gameState->optionsMenu.fontSize, 1.f, BLACK);
-  DrawTextEx(GetFontDefault(), gameState->gameText[MAIN_MENU], gameState->optionsMenu.goBackToMainMenuTextPosition, gameState->optionsMenu.fontSize, 1.f, BLACK);
+  return (gameState->input.keysDown >> key) & 1u;
 }
 
-void UpdateControlsMenu() {}
-void RenderControlsMenu() {}
+bool
+InputKeyPressed(GameKey key)
+{
+  return (gameState->input.keysPressed >> key) & 1u;
+}
 
-void UpdateCraftingScene()
+bool
+InputMouseDown(int button)
 {
-  if (IsMouseButtonDown(MOUSE_BUTTON_LEFT) && player->craftingInventory->dragging) {
-    Vector2 difference = Vector2Subtract(gameState->mousePosition, gameState->previousMousePosition);
-    player->craftingInventory->rect.x += difference.x;
-    player->craftingInventory->rect.y += difference.y;
-    player->craftingInventory->dragRect.x += difference.x;
-    player->craftingInventory->dragRect.y += difference.y;
-  }
-  
-  if (CheckCollisionPointRec(gameState->mousePosition, player->craftingInventory->dragRect)) {
-    if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
-      player->recentInventoryOpened = 1; // crafting inventory is open
-      player->craftingInventory->dragging = true;
-    } 
-  }
-  
-  if (CheckCollisionPointRec(gameState->mousePosition, player->craftingInventory->rect)) {
-    if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
-      player->recentInventoryOpened = 1;
-    }
-  }
+  return (gameState->input.mouseDown >> button) & 1u;
+}
 
-  if (!IsMouseButtonDown(MOUSE_BUTTON_LEFT)) {
-    player->craftingInventory->dragging = false;
-  }
+bool
+InputMousePressed(int button)
+{
+  return (gameState->input.mousePressed >> button) & 1u;
 }
 
-void RenderCraftingScene()
+/*
+  Menu layout only needs the size of each game text, measured once the font is loaded.
+  The sizes also go in replay files, a replay puts them straight in the UI's text cache
+*/
+void
+MeasureGameTexts()
 {
-  DrawRectangleRec(player->craftingInventory->rect,     BROWN);
-  DrawRectangleRec(player->craftingInventory->dragRect, BLACK);
+  for (int i = 0; i < TEXT_COUNT; i++) {
+    gameState->textSizes[i] = UiMeasureText(&gameState->ui, gameState->gameText[i], MENU_FONT_SIZE);
+  }
 }
 
-void UpdateInventory()
+/*
+  STRING TABLES
+  Compiled from the src/text files by tools/textCompiler.c. A table is mapped
+  (or read in one go) the first time its language is used and stays loaded,
+  the strings are looked up in place
+*/
+bool
+LoadLanguage(Language language)
 {
-  if (IsMouseButtonDown(MOUSE_BUTTON_LEFT) && player->inventory->dragging) {
-    Vector2 difference = Vector2Subtract(gameState->mousePosition, gameState->previousMousePosition);
-    player->inventory->rect.x += difference.x;
-    player->inventory->rect.y += difference.y;
-    player->inventory->dragRect.x += difference.x;
-    player->inventory->dragRect.y += difference.y;
+  if (gameState->stringsLoaded[language]) {
+    return gameState->strings[language].count > 0;
   }
+  gameState->stringsLoaded[language] = true;
 
-  if (CheckCollisionPointRec(gameState->mousePosition, player->inventory->dragRect)) {
-    if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
-      player->inventory->dragging = true;
-      player->recentInventoryOpened = 0;
-    }
+  char path[64];
+  snprintf(path, sizeof(path), TEXT_DIRECTORY "%s.strings", languageCodes[language]);
+  MappedFile* file = &gameState->stringFiles[language];
+  if (!OpenMappedFile(path, file)) {
+    printf("%s: failed to open string table.\n", path);
+    return false;
   }
-  
-  if (CheckCollisionPointRec(gameState->mousePosition, player->inventory->rect)) {
-    if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
-      player->recentInventoryOpened = 0;
+  if (!StringTableLoad(&gameState->strings[language], file->data, file->size, TEXT_COUNT, TEXT_KEYS_HASH)) {
+    printf("%s: string table is damaged or out of date, rerun tools/textCompiler.c.\n", path);
+    CloseMappedFile(file);
+    return false;
+  }
+  return true;
+}
+
+/* The current language, then English, then the key name so a missing string is obvious */
+const char*
+GameString(TextNames id)
+{
+  const char* text = StringTableGet(&gameState->strings[gameState->language], id);
+  if (!text) {
+    text = StringTableGet(&gameState->strings[LANGUAGE_EN], id);
+  }
+  return text ? text : textKeys[id];
+}
+
+/* Menus keep the gameText pointers, so this goes before InitGame */
+void
+SetGameLanguage(Language language)
+{
+  LoadLanguage(LANGUAGE_EN);
+  LoadLanguage(language);
+  gameState->language = language;
+  for (int i = 0; i < TEXT_COUNT; i++) {
+    gameState->gameText[i] = GameString((TextNames)i);
+  }
+}
+
+/* -1 when there's no such language */
+int
+FindLanguage(const char* code)
+{
+  for (int i = 0; i < LANGUAGE_COUNT; i++) {
+    if (strcmp(code, languageCodes[i]) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/*
+  Menu text gets an atlas baked at its size, then every game text is laid out
+  into a run up front so the first menu frame doesn't do it
+*/
+void
+LoadGameFonts()
+{
+  if (TextCacheAddAtlas(&gameState->text, GetFontDefault(), MENU_FONT_SIZE) == -1) {
+    printf("Failed to bake the menu font atlas, menus fall back to DrawTextEx.\n");
+    return;
+  }
+  for (int i = 0; i < TEXT_COUNT; i++) {
+    TextCacheRun(&gameState->text, gameState->gameText[i], MENU_FONT_SIZE);
+  }
+}
+
+/* What the UI measures text with, only called for strings not in its cache */
+Vector2
+MeasureMenuText(const char* text, float fontSize)
+{
+  return MeasureTextEx(GetFontDefault(), text, fontSize, 1.f);
+}
+
+/* Only one menu is visible, and only visible menus can be hit */
+void
+ShowMenu(int menu)
+{
+  int menus[3] = {gameState->mainMenu, gameState->optionsMenu, gameState->controlsMenu};
+  for (int i = 0; i < 3; i++) {
+    UiSetVisible(&gameState->ui, menus[i], menus[i] == menu);
+  }
+}
+
+bool
+StartRecording(const char* path)
+{
+  InputReplay* replay = &gameState->replay;
+  replay->recordFile = fopen(path, "wb");
+  if (!replay->recordFile) {
+    printf("%s: failed to open replay file for writing.\n", path);
+    return false;
+  }
+  
+  ReplayFileHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, REPLAY_FILE_MAGIC, 4);
+  header.version = REPLAY_FILE_VERSION;
+  header.inputStateSize = sizeof(InputState);
+  header.textCount = TEXT_COUNT;
+  header.language = gameState->language;
+  header.seed = gameState->runSeed;
+  memcpy(header.textSizes, gameState->textSizes, sizeof(header.textSizes));
+  fwrite(&header, sizeof(header), 1, replay->recordFile);
+  return true;
+}
+
+bool
+LoadReplay(const char* path)
+{
+  int size = 0;
+  unsigned char* data = LoadFileData(path, &size);
+  if (!data) {
+    printf("%s: failed to open replay file.\n", path);
+    return false;
+  }
+  
+  ReplayFileHeader header;
+  if (size < (int)sizeof(header)) {
+    printf("%s: not a replay file.\n", path);
+    UnloadFileData(data);
+    return false;
+  }
+  memcpy(&header, data, sizeof(header));
+  if (memcmp(header.magic, REPLAY_FILE_MAGIC, 4) != 0 || header.version != REPLAY_FILE_VERSION ||
+      header.inputStateSize != (int)sizeof(InputState) || header.textCount != TEXT_COUNT ||
+      header.language < 0 || header.language >= LANGUAGE_COUNT) {
+    printf("%s: replay file is from a different version of the game.\n", path);
+    UnloadFileData(data);
+    return false;
+  }
+  
+  InputReplay* replay = &gameState->replay;
+  replay->data = data;
+  replay->frameCount = (size - (int)sizeof(header)) / (int)sizeof(InputState);
+  replay->frame = 0;
+  SetGameLanguage((Language)header.language);
+  gameState->runSeed = header.seed;
+  memcpy(gameState->textSizes, header.textSizes, sizeof(header.textSizes));
+  for (int i = 0; i < TEXT_COUNT; i++) {
+    UiCacheText(&gameState->ui, gameState->gameText[i], MENU_FONT_SIZE, gameState->textSizes[i]);
+  }
+  return true;
+}
+
+/* Closes the recording or frees the replay, both print how fast it ran and where the game ended up */
+void
+FinishReplay()
+{
+  InputReplay* replay = &gameState->replay;
+  if (!replay->recordFile && !replay->data) {
+    return;
+  }
+  
+  double seconds = (double)(clock() - replay->startTime) / CLOCKS_PER_SEC;
+  int frames = replay->recordFile ? replay->frameCount : replay->frame;
+  printf("%s %d frames in %.3f seconds, %.0f frames/sec, checksum %016llx.\n",
+         replay->recordFile ? "Recorded" : "Replayed", frames, seconds,
+         seconds > 0.0 ? frames / seconds : 0.0, (unsigned long long)GameStateChecksum());
+
+  if (replay->recordFile) {
+    fclose(replay->recordFile);
+    replay->recordFile = NULL;
+  }
+  if (replay->data) {
+    UnloadFileData(replay->data);
+    replay->data = NULL;
+  }
+}
+
+/*
+  Hash of the state a replay should reproduce exactly,
+  a recording and its replay print the same checksum
+*/
+uint64_t
+GameStateChecksum()
+{
+  uint64_t hash = HashMix64(gameState->simulationSteps);
+  uint32_t bits;
+  
+  EntityStore* entities = &gameState->entities;
+  hash = HashMix64(hash ^ (uint64_t)entities->count);
+  for (int i = 0; i < entities->count; i++) {
+    hash = HashMix64(hash ^ entities->entities[i]);
+    memcpy(&bits, &entities->positionX[i], sizeof(bits));
+    hash = HashMix64(hash ^ bits);
+    memcpy(&bits, &entities->positionY[i], sizeof(bits));
+    hash = HashMix64(hash ^ bits);
+  }
+
+  Inventory* inventories[2] = {player->inventory, player->craftingInventory};
+  for (int i = 0; i < 2; i++) {
+    memcpy(&bits, &inventories[i]->rect.x, sizeof(bits));
+    hash = HashMix64(hash ^ bits);
+    memcpy(&bits, &inventories[i]->rect.y, sizeof(bits));
+    hash = HashMix64(hash ^ bits);
+    hash = HashMix64(hash ^ (uint64_t)inventories[i]->items.length);
+  }
+
+  SceneStack* scenes = &gameState->scenes;
+  for (int i = 0; i < scenes->count; i++) {
+    hash = HashMix64(hash ^ (uint64_t)scenes->scenes[i]);
+  }
+  hash = HashMix64(hash ^ (uint64_t)(scenes->loading + 1));
+  hash = HashMix64(hash ^ (uint64_t)gameState->floor);
+  GameMap* map = &gameState->gameMap;
+  for (int tile = 0; tile < map->tileCount; tile++) {
+    hash = HashMix64(hash ^ (uint64_t)map->tileTypes[tile]);
+  }
+  return HashMix64(hash ^ (uint64_t)gameState->gameSettings.soundOn);
+}
+
+void
+RenderGame()
+{
+  BeginDrawing();
+  {
+    ClearBackground(RAYWHITE);
+    RenderScenes();
+
+    /* Last so it's on top of everything */
+    if (gameState->profilerVisible) {
+      RenderProfiler();
+    }
+  }
+  ProfileCall(&profiler, EndDrawing());
+}
+
+/*
+  SCENES
+  Changes to the stack are queued and applied after every scene has updated,
+  so a scene never runs half a frame on a stack that changed under it
+*/
+void
+PushScene(SceneId scene)
+{
+  SceneRequestRingPush(&gameState->scenes.requests, (SceneRequest){SCENE_REQUEST_PUSH, scene});
+}
+
+void
+SetScene(SceneId scene)
+{
+  SceneRequestRingPush(&gameState->scenes.requests, (SceneRequest){SCENE_REQUEST_SET, scene});
+}
+
+void
+PopScene()
+{
+  SceneRequestRingPush(&gameState->scenes.requests, (SceneRequest){SCENE_REQUEST_POP, SCENE_NONE});
+}
+
+void
+RemoveScene(SceneId scene)
+{
+  SceneRequestRingPush(&gameState->scenes.requests, (SceneRequest){SCENE_REQUEST_REMOVE, scene});
+}
+
+void
+RaiseScene(SceneId scene)
+{
+  SceneRequestRingPush(&gameState->scenes.requests, (SceneRequest){SCENE_REQUEST_RAISE, scene});
+}
+
+/* Stack index or -1 */
+int
+FindScene(SceneId scene)
+{
+  for (int i = 0; i < gameState->scenes.count; i++) {
+    if (gameState->scenes.scenes[i] == scene) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+bool
+SceneInStack(SceneId scene)
+{
+  return FindScene(scene) != -1;
+}
+
+void
+ToggleOverlay(SceneId scene)
+{
+  if (SceneInStack(scene)) {
+    RemoveScene(scene);
+  } else {
+    PushScene(scene);
+  }
+}
+
+void
+EnterScene(SceneId scene)
+{
+  SceneStack* stack = &gameState->scenes;
+  if (stack->count == MAX_SCENES || SceneInStack(scene)) {
+    return;
+  }
+  stack->scenes[stack->count++] = scene;
+  AcquireSceneAtlas(scene);
+  if (sceneTable[scene].enter) {
+    sceneTable[scene].enter();
+  }
+}
+
+void
+ExitScene(int index)
+{
+  SceneStack* stack = &gameState->scenes;
+  SceneId scene = stack->scenes[index];
+  memmove(&stack->scenes[index], &stack->scenes[index + 1], sizeof(SceneId) * (stack->count - index - 1));
+  stack->count--;
+  if (sceneTable[scene].exit) {
+    sceneTable[scene].exit();
+  }
+  ReleaseSceneAtlas(scene);
+}
+
+/*
+  A scene holds a reference on its atlas while it's on the stack. Overlays
+  coming and going don't unload anything, unused atlases are only collected
+  when a SET replaces the whole stack
+*/
+void
+AcquireSceneAtlas(SceneId scene)
+{
+  if (!sceneTable[scene].atlas || gameState->sceneAtlasHeld[scene]) {
+    return;
+  }
+  gameState->sceneAtlases[scene] = AssetAcquire(&gameState->assets, sceneTable[scene].atlas);
+  gameState->sceneAtlasHeld[scene] = true;
+}
+
+void
+ReleaseSceneAtlas(SceneId scene)
+{
+  if (!gameState->sceneAtlasHeld[scene]) {
+    return;
+  }
+  AssetRelease(&gameState->assets, gameState->sceneAtlases[scene]);
+  gameState->sceneAtlases[scene] = ASSET_NONE;
+  gameState->sceneAtlasHeld[scene] = false;
+}
+
+/* Top down, the same order they would be popped in */
+void
+ClearScenes()
+{
+  while (gameState->scenes.count > 0) {
+    ExitScene(gameState->scenes.count - 1);
+  }
+}
+
+void
+ApplySceneRequests()
+{
+  SceneStack* stack = &gameState->scenes;
+  while (SceneRequestRingCount(&stack->requests) > 0) {
+    SceneRequest request = SceneRequestRingPop(&stack->requests);
+    switch (request.type) {
+    case SCENE_REQUEST_PUSH:
+    case SCENE_REQUEST_SET:
+      /* Scenes with a preload go on the stack once it finishes, see UpdateScenes */
+      if (sceneTable[request.scene].preload) {
+        if (stack->loading != SCENE_NONE && stack->loading != request.scene) {
+          ReleaseSceneAtlas(stack->loading);
+        }
+        /* Held from the start so the preload can draw from it */
+        AcquireSceneAtlas(request.scene);
+        stack->loading = request.scene;
+        stack->loadingReplaces = request.type == SCENE_REQUEST_SET;
+        stack->loadingProgress = 0;
+        break;
+      }
+      if (request.type == SCENE_REQUEST_SET) {
+        ClearScenes();
+        EnterScene(request.scene);
+        AssetCollect(&gameState->assets);
+        break;
+      }
+      EnterScene(request.scene);
+      break;
+    case SCENE_REQUEST_POP:
+      if (stack->count > 0) {
+        ExitScene(stack->count - 1);
+      }
+      break;
+    case SCENE_REQUEST_REMOVE: {
+      int index = FindScene(request.scene);
+      if (index != -1) {
+        ExitScene(index);
+      }
+    } break;
+    case SCENE_REQUEST_RAISE: {
+      int index = FindScene(request.scene);
+      if (index != -1) {
+        memmove(&stack->scenes[index], &stack->scenes[index + 1], sizeof(SceneId) * (stack->count - index - 1));
+        stack->scenes[stack->count - 1] = request.scene;
+      }
+    } break;
+    }
+  }
+}
+
+/* Lowest scene that can be seen, everything under the topmost opaque scene is hidden */
+int
+FirstVisibleScene()
+{
+  SceneStack* stack = &gameState->scenes;
+  int first = stack->count - 1;
+  while (first > 0 && !sceneTable[stack->scenes[first]].opaque) {
+    first--;
+  }
+  return first;
+}
+
+/*
+  Top down so the scene in front sees input first, it sets mouseHandled
+  when it takes a click. A preload in progress holds the stack as it is
+*/
+void
+UpdateScenes()
+{
+  SceneStack* stack = &gameState->scenes;
+  if (stack->loading != SCENE_NONE) {
+    ProfileBegin(&profiler, "PreloadScene");
+    bool loaded = sceneTable[stack->loading].preload(&stack->loadingProgress);
+    ProfileEnd(&profiler);
+    if (loaded) {
+      if (stack->loadingReplaces) {
+        ClearScenes();
+      }
+      SceneId scene = stack->loading;
+      stack->loading = SCENE_NONE;
+      EnterScene(scene);
+      if (stack->loadingReplaces) {
+        AssetCollect(&gameState->assets);
+      }
+    }
+    return;
+  }
+
+  for (int i = stack->count - 1; i >= 0 && i >= FirstVisibleScene(); i--) {
+    const Scene* scene = &sceneTable[stack->scenes[i]];
+    if (scene->update) {
+      ProfileBegin(&profiler, scene->name);
+      scene->update();
+      ProfileEnd(&profiler);
+    }
+  }
+  ApplySceneRequests();
+}
+
+/* Bottom up from the first visible scene so the top of the stack is drawn last */
+void
+RenderScenes()
+{
+  SceneStack* stack = &gameState->scenes;
+  for (int i = FirstVisibleScene(); i >= 0 && i < stack->count; i++) {
+    const Scene* scene = &sceneTable[stack->scenes[i]];
+    if (scene->render) {
+      scene->render();
+    }
+  }
+}
+
+/* In game, the inventory and crafting overlays open on top of it */
+void
+UpdateGameScene()
+{
+  if (InputKeyPressed(GAME_KEY_INVENTORY)) {
+    ToggleOverlay(SCENE_INVENTORY);
+  }
+  if (InputKeyPressed(GAME_KEY_CRAFTING)) {
+    ToggleOverlay(SCENE_CRAFTING);
+  }
+
+  /* A new floor's first view bakes a few chunks per frame, nothing moves until it's done */
+  if (gameState->floorLoading >= 0) {
+    if (PreloadGameScene(&gameState->floorLoading)) {
+      gameState->floorLoading = -1;
+    }
+    return;
+  }
+  
+  ProfileCall(&profiler, AdvanceSimulation(gameState->input.frameTime));
+
+  /* Stairs under the middle of the player go up */
+  EntityStore* entities = &gameState->entities;
+  GameMap* map = &gameState->gameMap;
+  int playerIndex = EntityIndex(entities, player->entity);
+  if (playerIndex != -1) {
+    int x = (int)(entities->positionX[playerIndex] + entities->sizeX[playerIndex] / 2.f);
+    int y = (int)(entities->positionY[playerIndex] + entities->sizeY[playerIndex] / 2.f);
+    if (x < map->width && y < map->height && map->tileTypes[y * map->width + x] == TILE_STAIRS) {
+      ProfileCall(&profiler, EnterNextFloor());
+      return;
+    }
+    if (InputKeyPressed(GAME_KEY_TORCH)) {
+      ToggleTorchNear(map, x, y);
+    }
+  }
+  ProfileCall(&profiler, UpdateGameMap());
+}
+
+/*
+  Bakes the chunks of the first view a few per frame before the game shows,
+  instead of all of them in the first game frame. progress is the next chunk
+  in the view, it still advances headless where nothing is baked so replays
+  take the same number of frames either way
+*/
+bool
+PreloadGameScene(int* progress)
+{
+  /*
+    Chunks bake from the world atlas, if its png is still decoding it's waited for.
+    On web with threads the decode's file read runs on this thread between frames,
+    so the preload polls and AssetUpdate uploads the png once it's done
+  */
+#if defined(PLATFORM_WEB) && JOB_THREADS
+  if (AssetLoading(&gameState->assets, gameState->sceneAtlases[SCENE_GAME])) {
+    return false;
+  }
+#else
+  AssetFinishLoading(&gameState->assets, gameState->sceneAtlases[SCENE_GAME]);
+#endif
+
+  GameMap* map = &gameState->gameMap;
+  map->frame++;
+  UpdateGameMapView(map);
+
+  int columns = map->visibleChunkMax.x - map->visibleChunkMin.x + 1;
+  int rows = map->visibleChunkMax.y - map->visibleChunkMin.y + 1;
+  int total = columns * rows;
+  for (int budget = MAP_CHUNK_PRELOAD_PER_FRAME; budget > 0 && *progress < total; budget--, (*progress)++) {
+    int x = map->visibleChunkMin.x + *progress % columns;
+    int y = map->visibleChunkMin.y + *progress / columns;
+    int slot = FindGameMapChunk(map, x, y);
+    if (slot == -1) {
+      slot = LoadGameMapChunk(map, x, y);
+    }
+    if (slot != -1) {
+      map->chunkLastUsed[slot] = map->frame;
+    }
+  }
+  if (*progress < total) {
+    return false;
+  }
+  /* The first light build does the whole map, here rather than in the first game frame */
+  UpdateGameMapLight(map);
+  return true;
+}
+
+/* Chunk textures are only needed in game */
+void
+ExitGameScene()
+{
+  ResetGameMapChunks(&gameState->gameMap);
+  gameState->floorLoading = -1;
+}
+
+void
+ExitInventory()
+{
+  player->inventory->dragging = false;
+}
+
+void
+ExitCraftingScene()
+{
+  player->craftingInventory->dragging = false;
+}
+
+void
+UpdateMainMenu()
+{
+  ShowMenu(gameState->mainMenu);
+  switch (UiUpdate(&gameState->ui, gameState->mousePosition, InputMousePressed(MOUSE_BUTTON_LEFT))) {
+  case MENU_ACTION_START_GAME:
+    SetScene(SCENE_GAME);
+    break;
+  case MENU_ACTION_OPTIONS:
+    PushScene(SCENE_OPTIONS_MENU);
+    break;
+  case MENU_ACTION_EXIT_GAME:
+    gameState->running = false;
+    break;
+  }
+}
+
+void
+RenderMainMenu()
+{
+  UiRender(&gameState->ui, gameState->mainMenu);
+}
+
+void
+UpdateOptionsMenu()
+{
+  ShowMenu(gameState->optionsMenu);
+  switch (UiUpdate(&gameState->ui, gameState->mousePosition, InputMousePressed(MOUSE_BUTTON_LEFT))) {
+  case MENU_ACTION_TOGGLE_SOUND:
+    gameState->gameSettings.soundOn = !gameState->gameSettings.soundOn;
+    printf("Changing sound setting - %d\n", gameState->gameSettings.soundOn);
+    break;
+  case MENU_ACTION_CONTROLS:
+    PushScene(SCENE_CONTROLS_MENU);
+    break;
+  case MENU_ACTION_MAIN_MENU:
+    PopScene();
+    break;
+  }
+}
+
+void
+RenderOptionsMenu()
+{
+  UiRender(&gameState->ui, gameState->optionsMenu);
+}
+
+void
+UpdateControlsMenu()
+{
+  ShowMenu(gameState->controlsMenu);
+  if (UiUpdate(&gameState->ui, gameState->mousePosition, InputMousePressed(MOUSE_BUTTON_LEFT)) == MENU_ACTION_OPTIONS) {
+    PopScene();
+  }
+}
+
+void
+RenderControlsMenu()
+{
+  UiRender(&gameState->ui, gameState->controlsMenu);
+}
+
+void UpdateCraftingScene()
+{
+  /* Transmute whatever is in the crafting inventory */
+  ItemList* ingredients = &player->craftingInventory->items;
+  if (InputKeyPressed(GAME_KEY_CRAFT) && ingredients->length > 0) {
+    int itemIds[MAX_INVENTORY_ITEMS];
+    for (size_t i = 0; i < ingredients->length; i++) {
+      itemIds[i] = ItemListAt(ingredients, i)->id;
+    }
+    int recipe = FindRecipe(&gameState->recipeBook, itemIds, (int)ingredients->length);
+    if (recipe != -1 && AddInventoryItem(player->inventory, gameState->recipeBook.recipes[recipe].result)) {
+      ItemListClear(ingredients);
+    }
+  }
+  
+  DragInventory(player->craftingInventory);
+
+  /* Clicks go to the topmost overlay under the mouse, and bring it to the front */
+  if (InputMousePressed(MOUSE_BUTTON_LEFT) && !gameState->mouseHandled &&
+      CheckCollisionPointRec(gameState->mousePosition, player->craftingInventory->rect)) {
+    gameState->mouseHandled = true;
+    RaiseScene(SCENE_CRAFTING);
+    if (CheckCollisionPointRec(gameState->mousePosition, player->craftingInventory->dragRect)) {
+      player->craftingInventory->dragging = true;
+      player->craftingInventory->dragOffset = Vector2Subtract(gameState->mousePosition, (Vector2){player->craftingInventory->rect.x, player->craftingInventory->rect.y});
+    }
+  }
+
+  if (!InputMouseDown(MOUSE_BUTTON_LEFT)) {
+    player->craftingInventory->dragging = false;
+  }
+}
+
+void RenderCraftingScene()
+{
+  if (!AssetDrawSprite(&gameState->assets, player->craftingInventory->sprite, player->craftingInventory->rect, WHITE)) {
+    DrawRectangleRec(player->craftingInventory->rect, BROWN);
+  }
+  DrawRectangleRec(player->craftingInventory->dragRect, BLACK);
+  RenderInventoryItems(player->craftingInventory);
+
+  /* A lone item that something makes shows its recipe, the ingredients faded in the slots after it */
+  ItemList* items = &player->craftingInventory->items;
+  int recipe = items->length == 1 ? FindRecipeMaking(&gameState->recipeBook, ItemListAt(items, 0)->id) : -1;
+  if (recipe != -1) {
+    const Recipe* shown = &gameState->recipeBook.recipes[recipe];
+    for (int i = 0; i < shown->ingredientCount; i++) {
+      Rectangle slot = GetInventorySlotRect(player->craftingInventory, i + 1);
+      char spriteName[32];
+      snprintf(spriteName, sizeof(spriteName), "item%d", shown->ingredients[i]);
+      if (!AssetDrawSprite(&gameState->assets, AssetNameKey(spriteName), slot, Fade(WHITE, 0.4f))) {
+        DrawRectangleRec(slot, Fade(DARKGRAY, 0.4f));
+      }
+    }
+  }
+}
+
+void UpdateInventory()
+{
+  DragInventory(player->inventory);
+
+  /* Clicks go to the topmost overlay under the mouse, and bring it to the front */
+  if (InputMousePressed(MOUSE_BUTTON_LEFT) && !gameState->mouseHandled &&
+      CheckCollisionPointRec(gameState->mousePosition, player->inventory->rect)) {
+    gameState->mouseHandled = true;
+    RaiseScene(SCENE_INVENTORY);
+    if (CheckCollisionPointRec(gameState->mousePosition, player->inventory->dragRect)) {
+      player->inventory->dragging = true;
+      player->inventory->dragOffset = Vector2Subtract(gameState->mousePosition, (Vector2){player->inventory->rect.x, player->inventory->rect.y});
+    }
+  }
+
+  if (!InputMouseDown(MOUSE_BUTTON_LEFT)) {
+    player->inventory->dragging = false;
+  }
+}
+
+void RenderInventory()
+{
+  if (!AssetDrawSprite(&gameState->assets, player->inventory->sprite, player->inventory->rect, WHITE)) {
+    DrawRectangleRec(player->inventory->rect, PURPLE);
+  }
+  DrawRectangleRec(player->inventory->dragRect, BLACK);
+  RenderInventoryItems(player->inventory);
+}
+
+/*
+  Items in a grid under the drag bar, every sprite comes from the items atlas
+  so the whole grid is one batch
+*/
+void
+RenderInventoryItems(Inventory* inventory)
+{
+  for (int i = 0; i < (int)inventory->items.length; i++) {
+    Rectangle slot = GetInventorySlotRect(inventory, i);
+    if (!AssetDrawSprite(&gameState->assets, ItemListAt(&inventory->items, (size_t)i)->sprite, slot, WHITE)) {
+      DrawRectangleRec(slot, DARKGRAY);
+    }
+  }
+}
+
+/* Slot i of the grid under the drag bar, row by row */
+Rectangle
+GetInventorySlotRect(Inventory* inventory, int slot)
+{
+  float top = inventory->dragRect.y + inventory->dragRect.height;
+  float slotSize = fminf(inventory->rect.width, inventory->rect.y + inventory->rect.height - top) / INVENTORY_COLUMNS;
+  return (Rectangle){inventory->rect.x + (slot % INVENTORY_COLUMNS) * slotSize + INVENTORY_SLOT_PADDING,
+                     top + (slot / INVENTORY_COLUMNS) * slotSize + INVENTORY_SLOT_PADDING,
+                     slotSize - INVENTORY_SLOT_PADDING * 2.f, slotSize - INVENTORY_SLOT_PADDING * 2.f};
+}
+
+void UpdateGameMap()
+{
+  GameMap* map = &gameState->gameMap;
+  map->frame++;
+  UpdateGameMapView(map);
+
+  /* Tile under the mouse straight from the tile size, no per tile checks */
+  Vector2 mouseWorld = GetScreenToWorld2D(gameState->mousePosition, map->camera);
+  int hoveredTile = -1;
+  if (mouseWorld.x >= 0.f && mouseWorld.y >= 0.f) {
+    int x = (int)(mouseWorld.x / map->tileSize.x);
+    int y = (int)(mouseWorld.y / map->tileSize.y);
+    if (x < map->width && y < map->height) {
+      hoveredTile = y * map->width + x;
+    }
+  }
+
+  /* Highlight is drawn as an overlay, the baked chunks don't change */
+  map->hoveredTile = hoveredTile;
+
+  ProfileCall(&profiler, UpdateGameMapLight(map));
+
+  /* Chunks the camera sees have to be resident this frame */
+  for (int y = map->visibleChunkMin.y; y <= map->visibleChunkMax.y; y++) {
+    for (int x = map->visibleChunkMin.x; x <= map->visibleChunkMax.x; x++) {
+      int slot = FindGameMapChunk(map, x, y);
+      if (slot == -1) {
+        slot = LoadGameMapChunk(map, x, y);
+      }
+      if (slot != -1) {
+        map->chunkLastUsed[slot] = map->frame;
+      }
     }
   }
 
-  if (!IsMouseButtonDown(MOUSE_BUTTON_LEFT)) {
-    player->inventory->dragging = false;
+  /*
+    Neighbouring chunks are loaded ahead of the camera a few per frame
+    so scrolling never has to bake a whole row of chunks at once
+  */
+  int prefetchBudget = MAP_CHUNK_PREFETCH_PER_FRAME;
+  for (int y = map->visibleChunkMin.y - 1; y <= map->visibleChunkMax.y + 1; y++) {
+    for (int x = map->visibleChunkMin.x - 1; x <= map->visibleChunkMax.x + 1; x++) {
+      if (x < 0 || y < 0 || x >= map->chunkCount.x || y >= map->chunkCount.y) {
+        continue;
+      }
+      int slot = FindGameMapChunk(map, x, y);
+      if (slot == -1 && prefetchBudget > 0) {
+        slot = LoadGameMapChunk(map, x, y);
+        prefetchBudget--;
+      }
+      if (slot != -1) {
+        map->chunkLastUsed[slot] = map->frame;
+      }
+    }
   }
 }
-void RenderInventory()
+
+/* Camera and the range of chunks it sees, shared by the map update and the game scene preload */
+void
+UpdateGameMapView(GameMap* map)
 {
-  DrawRectangleRec(player->inventory->rect,     PURPLE);
-  DrawRectangleRec(player->inventory->dragRect, BLACK);
+  /* Camera follows where the player is drawn, kept inside the map */
+  int playerIndex = EntityIndex(&gameState->entities, player->entity);
+  if (playerIndex != -1) {
+    EntityStore* entities = &gameState->entities;
+    float alpha = gameState->simulationAlpha;
+    float playerX = Lerp(entities->previousX[playerIndex], entities->positionX[playerIndex], alpha);
+    float playerY = Lerp(entities->previousY[playerIndex], entities->positionY[playerIndex], alpha);
+    map->camera.target.x = playerX * map->tileSize.x - gameState->screenSize.x / 2.f;
+    map->camera.target.y = playerY * map->tileSize.y - gameState->screenSize.y / 2.f;
+  }
+  map->camera.target.x = Clamp(map->camera.target.x, 0.f, fmaxf(0.f, map->width * map->tileSize.x - gameState->screenSize.x));
+  map->camera.target.y = Clamp(map->camera.target.y, 0.f, fmaxf(0.f, map->height * map->tileSize.y - gameState->screenSize.y));
+
+  /* Chunks intersecting the view have to be resident this frame */
+  float chunkWidth = map->tileSize.x * MAP_CHUNK_SIZE;
+  float chunkHeight = map->tileSize.y * MAP_CHUNK_SIZE;
+  map->visibleChunkMin.x = (int)(map->camera.target.x / chunkWidth);
+  map->visibleChunkMin.y = (int)(map->camera.target.y / chunkHeight);
+  map->visibleChunkMax.x = (int)((map->camera.target.x + gameState->screenSize.x - 1.f) / chunkWidth);
+  map->visibleChunkMax.y = (int)((map->camera.target.y + gameState->screenSize.y - 1.f) / chunkHeight);
+  if (map->visibleChunkMax.x >= map->chunkCount.x) map->visibleChunkMax.x = map->chunkCount.x - 1;
+  if (map->visibleChunkMax.y >= map->chunkCount.y) map->visibleChunkMax.y = map->chunkCount.y - 1;
 }
 
-void UpdateGameMap()
+void
+RenderGameMap()
 {
-  Vector2 mousePosition = GetMousePosition();
-  for (int y = 0; y < 10; y++) {
-    for (int x = 0; x < 10; x++) {
-      if (CheckCollisionPointRec(mousePosition, gameState->gameMap[y][x].tileRect)) {
-	gameState->gameMap[y][x].tileColor = RED;
-      } else {
-	gameState->gameMap[y][x].tileColor = BLACK;
+  GameMap* map = &gameState->gameMap;
+  float chunkWidth = map->tileSize.x * MAP_CHUNK_SIZE;
+  float chunkHeight = map->tileSize.y * MAP_CHUNK_SIZE;
+  
+  BeginMode2D(map->camera);
+  {
+    /* Only chunks in the view, render textures are stored upside down */
+    for (int y = map->visibleChunkMin.y; y <= map->visibleChunkMax.y; y++) {
+      for (int x = map->visibleChunkMin.x; x <= map->visibleChunkMax.x; x++) {
+        int slot = FindGameMapChunk(map, x, y);
+        if (slot == -1) {
+          continue;
+        }
+        Texture2D chunk = map->chunkTextures[slot].texture;
+        DrawTexturePro(chunk, (Rectangle){0.f, 0.f, (float)chunk.width, -(float)chunk.height},
+                       (Rectangle){x * chunkWidth, y * chunkHeight, chunkWidth, chunkHeight},
+                       (Vector2){0.f, 0.f}, 0.f, WHITE);
       }
     }
+    
+    ProfileCall(&profiler, RenderEntities());
+    LightMapDraw(&map->light, map->tileSize);
+
+    if (map->hoveredTile != -1) {
+      DrawRectangleLinesEx(GetGameMapTileRect(map, map->hoveredTile), 1.f, RED);
+    }
   }
+  EndMode2D();
 }
 
+/*
+  F3 overlay, frame time graph over the last PROFILER_HISTORY frames and every
+  scope's last/average/max ms indented by how deep it ran, then the counters
+*/
 void
-RenderGameMap()
+RenderProfiler()
+{
+  const float fontSize = 20.f;
+  const float lineHeight = 22.f;
+  const float graphHeight = 80.f;
+  const float graphMs = 33.3f; // top of the graph
+  float width = 560.f;
+  float x = gameState->screenSize.x - width - 10.f;
+  float y = 10.f;
+  float height = graphHeight + lineHeight * (profiler.scopeCount + profiler.counterCount + 2) + 30.f;
+  DrawRectangleRec((Rectangle){x, y, width, height}, Fade(BLACK, 0.8f));
+
+  /* Newest frame on the right, 16.6ms line is the 60 fps budget */
+  float barWidth = width / PROFILER_HISTORY;
+  for (int i = 0; i < PROFILER_HISTORY; i++) {
+    float ms = profiler.frameTimes[(profiler.frameIndex + 1 + i) % PROFILER_HISTORY];
+    float barHeight = fminf(ms / graphMs, 1.f) * graphHeight;
+    Color color = ms > 1000.f / SIMULATION_HZ + 0.5f ? RED : GREEN;
+    DrawRectangleRec((Rectangle){x + i * barWidth, y + 10.f + graphHeight - barHeight, barWidth, barHeight}, color);
+  }
+  float budgetY = y + 10.f + graphHeight - (1000.f / SIMULATION_HZ) / graphMs * graphHeight;
+  DrawLineV((Vector2){x, budgetY}, (Vector2){x + width, budgetY}, YELLOW);
+  
+  float textY = y + graphHeight + 20.f;
+  DrawText(FrameTextFormat("frame %.2f ms   %-6s %7s %7s %7s %5s", profiler.frameTimes[profiler.frameIndex],
+                           "", "last", "avg", "max", "calls"),
+           (int)x + 10, (int)textY, (int)fontSize, RAYWHITE);
+  textY += lineHeight;
+  for (int i = 0; i < profiler.scopeCount; i++) {
+    ProfileScope* scope = &profiler.scopes[i];
+    int nameLength = (int)strcspn(scope->name, "(");
+    DrawText(FrameTextFormat("%*s%-*.*s %7.3f %7.3f %7.3f %5u", scope->depth * 2, "", 22 - scope->depth * 2, nameLength,
+                             scope->name, scope->lastTime / 1000.0, scope->averageTime / 1000.0,
+                             scope->maxTime / 1000.0, scope->lastCalls),
+             (int)x + 10, (int)textY, (int)fontSize, RAYWHITE);
+    textY += lineHeight;
+  }
+  textY += lineHeight;
+  for (int i = 0; i < profiler.counterCount; i++) {
+    DrawText(FrameTextFormat("%-22s %10.0f", profiler.counters[i].name, profiler.counters[i].lastValue),
+             (int)x + 10, (int)textY, (int)fontSize, SKYBLUE);
+    textY += lineHeight;
+  }
+}
+
+void
+UpdatePlayer()
+{
+  EntityStore* entities = &gameState->entities;
+  int i = EntityIndex(entities, player->entity);
+  if (i == -1) {
+    return;
+  }
+  
+  Vector2 direction = {0.f, 0.f};
+  if (InputKeyDown(GAME_KEY_LEFT))  direction.x -= 1.f;
+  if (InputKeyDown(GAME_KEY_RIGHT)) direction.x += 1.f;
+  if (InputKeyDown(GAME_KEY_UP))    direction.y -= 1.f;
+  if (InputKeyDown(GAME_KEY_DOWN))  direction.y += 1.f;
+  direction = Vector2Normalize(direction);
+  entities->velocityX[i] = direction.x * PLAYER_SPEED;
+  entities->velocityY[i] = direction.y * PLAYER_SPEED;
+}
+
+/*
+  Shadow monsters head for the player down the flow field to the tile the
+  player is on. It's built once per tile the player stands on and shared by
+  every monster, a monster outside its radius waits
+*/
+void
+UpdateShadowMonsters()
 {
-  for (int y = 0; y < 10; y++) {
-    for (int x = 0; x < 10; x++) {
-      DrawRectangleLinesEx(gameState->gameMap[y][x].tileRect, 1.f, gameState->gameMap[y][x].tileColor);
+  EntityStore* entities = &gameState->entities;
+  GameMap* map = &gameState->gameMap;
+  int playerIndex = EntityIndex(entities, player->entity);
+  if (playerIndex == -1) {
+    return;
+  }
+  int targetX = (int)(entities->positionX[playerIndex] + entities->sizeX[playerIndex] / 2.f);
+  int targetY = (int)(entities->positionY[playerIndex] + entities->sizeY[playerIndex] / 2.f);
+
+  const PathFlowField* field = NULL;
+  for (int i = 0; i < entities->count; i++) {
+    if (entities->kinds[i] != ENTITY_SHADOW_MONSTER) {
+      continue;
+    }
+    if (!field) {
+      field = PathFlowFieldFor(&map->flowFields, &map->path, targetX, targetY);
+    }
+    int x = (int)(entities->positionX[i] + entities->sizeX[i] / 2.f);
+    int y = (int)(entities->positionY[i] + entities->sizeY[i] / 2.f);
+    int direction = PathFlowDirection(&map->flowFields, field, x, y);
+    Vector2 velocity = {0.f, 0.f};
+    if (direction != PATH_NO_DIRECTION) {
+      velocity = Vector2Scale(Vector2Normalize((Vector2){(float)pathDirections[direction][0],
+                                                         (float)pathDirections[direction][1]}),
+                              SHADOW_MONSTER_SPEED);
     }
+    entities->velocityX[i] = velocity.x;
+    entities->velocityY[i] = velocity.y;
   }
 }
 
+/*
+  Movement system, one loop over the dense arrays.
+  Entities without COMPONENT_VELOCITY have a zero velocity and never reach
+  the tile checks. Positions are the entity's top left corner, everything
+  stays inside the map and out of solid tiles. X moves first then Y, so
+  running into a wall at an angle slides along it instead of stopping.
+*/
 void
-LoadCSVGameMap(const char* path, GameMapTile** mapBuffer)
+UpdateEntities(float deltaTime)
 {
-  FILE* file = fopen(path, "r");
-  if (!file) {
-#ifdef DEBUG
-    printf("Failed to open map csv file.\n");
+  EntityStore* entities = &gameState->entities;
+  GameMap* map = &gameState->gameMap;
+  int count = entities->count;
+  
+  float* positionX = entities->positionX;
+  float* positionY = entities->positionY;
+  const float* velocityX = entities->velocityX;
+  const float* velocityY = entities->velocityY;
+  const float* sizeX = entities->sizeX;
+  const float* sizeY = entities->sizeY;
+  for (int i = 0; i < count; i++) {
+    float x = Clamp(positionX[i] + velocityX[i] * deltaTime, 0.f, fmaxf(0.f, map->width - sizeX[i]));
+    /* Something already in a wall (spawned there) may walk out of it */
+    if (x != positionX[i] && GameMapBoxSolid(map, x, positionY[i], sizeX[i], sizeY[i]) &&
+        !GameMapBoxSolid(map, positionX[i], positionY[i], sizeX[i], sizeY[i])) {
+      /* Up against the edge of the tile it ran into, or where it was if that's still solid */
+      float flush = x > positionX[i] ? floorf(x + sizeX[i]) - sizeX[i] : ceilf(x);
+      x = GameMapBoxSolid(map, flush, positionY[i], sizeX[i], sizeY[i]) ? positionX[i] : flush;
+    }
+    positionX[i] = x;
+
+    float y = Clamp(positionY[i] + velocityY[i] * deltaTime, 0.f, fmaxf(0.f, map->height - sizeY[i]));
+    if (y != positionY[i] && GameMapBoxSolid(map, positionX[i], y, sizeX[i], sizeY[i]) &&
+        !GameMapBoxSolid(map, positionX[i], positionY[i], sizeX[i], sizeY[i])) {
+      float flush = y > positionY[i] ? floorf(y + sizeY[i]) - sizeY[i] : ceilf(y);
+      y = GameMapBoxSolid(map, positionX[i], flush, sizeX[i], sizeY[i]) ? positionY[i] : flush;
+    }
+    positionY[i] = y;
+  }
+}
+
+/*
+  Called inside the map's BeginMode2D, positions are converted from tiles to world pixels.
+  Drawn between the previous and current step so movement is smooth at any frame rate
+*/
+void
+RenderEntities()
+{
+  EntityStore* entities = &gameState->entities;
+  Vector2 tileSize = gameState->gameMap.tileSize;
+  float alpha = gameState->simulationAlpha;
+  for (int i = 0; i < entities->count; i++) {
+    float x = Lerp(entities->previousX[i], entities->positionX[i], alpha);
+    float y = Lerp(entities->previousY[i], entities->positionY[i], alpha);
+    Rectangle rect = {x * tileSize.x, y * tileSize.y,
+                      entities->sizeX[i] * tileSize.x, entities->sizeY[i] * tileSize.y};
+    DrawRectangleRec(rect, entityKindColors[entities->kinds[i]]);
+  }
+}
+
+void
+AllocateGameMap(GameMap* map, int width, int height)
+{
+  int tileCount = width * height;
+
+  /* A new map starts a new level, everything in levelArena goes with the old one */
+  UnloadGameMap(map);
+  map->tileTypes = ArenaPushArray(&levelArena, int, tileCount);
+  map->solid = ArenaPushArray(&levelArena, unsigned char, tileCount);
+  void* lightMemory = ArenaPush(&levelArena, LightMapMemorySize(width, height), ARENA_DEFAULT_ALIGN);
+  void* pathMemory = ArenaPush(&levelArena, PathGridMemorySize(tileCount), ARENA_DEFAULT_ALIGN);
+  void* flowMemory = ArenaPush(&levelArena, PathFlowCacheMemorySize(MAP_FLOW_FIELD_RADIUS), ARENA_DEFAULT_ALIGN);
+  if (!map->tileTypes || !map->solid || !lightMemory || !pathMemory || !flowMemory) {
+    printf("Failed to allocate game map memory (%dx%d), level arena is %d bytes.\n",
+           width, height, GAME_LEVEL_MEMORY_SIZE);
     exit(1);
+  }
+
+  map->width = width;
+  map->height = height;
+  map->tileCount = tileCount;
+  map->hoveredTile = -1;
+  map->chunkCount = (Vector2i){(width + MAP_CHUNK_SIZE - 1) / MAP_CHUNK_SIZE,
+                               (height + MAP_CHUNK_SIZE - 1) / MAP_CHUNK_SIZE};
+  for (int i = 0; i < MAP_MAX_RESIDENT_CHUNKS; i++) {
+    map->chunkCoords[i] = (Vector2i){-1, -1};
+  }
+  LightMapInit(&map->light, lightMemory, width, height);
+  map->playerLight = LIGHT_NONE;
+  memset(map->solid, 0, (size_t)tileCount);
+  PathGridInit(&map->path, pathMemory, width, height, map->solid);
+  PathFlowCacheInit(&map->flowFields, flowMemory, MAP_FLOW_FIELD_RADIUS);
+}
+
+void
+UnloadGameMap(GameMap* map)
+{
+  ResetGameMapChunks(map);
+  LightMapUnload(&map->light);
+  ArenaReset(&levelArena);
+  memset(map, 0, sizeof(GameMap));
+}
+
+void
+ResetGameMapChunks(GameMap* map)
+{
+  for (int i = 0; i < MAP_MAX_RESIDENT_CHUNKS; i++) {
+    if (map->chunkTextures[i].id != 0) {
+      UnloadRenderTexture(map->chunkTextures[i]);
+    }
+    memset(&map->chunkTextures[i], 0, sizeof(RenderTexture2D));
+    map->chunkCoords[i] = (Vector2i){-1, -1};
+    map->chunkLastUsed[i] = 0;
+  }
+}
+
+int
+FindGameMapChunk(GameMap* map, int chunkX, int chunkY)
+{
+  for (int i = 0; i < MAP_MAX_RESIDENT_CHUNKS; i++) {
+    if (map->chunkCoords[i].x == chunkX && map->chunkCoords[i].y == chunkY) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int
+LoadGameMapChunk(GameMap* map, int chunkX, int chunkY)
+{
+  /* Chunks are only for drawing, headless runs never make GPU resources */
+  if (gameState->headless) {
+    return -1;
+  }
+  ProfileCount(&profiler, "chunk bakes", 1.0);
+  
+  /* Free slot first, otherwise the least recently used one not needed this frame */
+  int slot = -1;
+  for (int i = 0; i < MAP_MAX_RESIDENT_CHUNKS; i++) {
+    if (map->chunkCoords[i].x == -1) {
+      slot = i;
+      break;
+    }
+    if (map->chunkLastUsed[i] != map->frame &&
+        (slot == -1 || map->chunkLastUsed[i] < map->chunkLastUsed[slot])) {
+      slot = i;
+    }
+  }
+  if (slot == -1) {
+    return -1;
+  }
+
+  /* Slot textures are reused, they only change size on a resize */
+  if (map->chunkTextures[slot].id == 0) {
+    map->chunkTextures[slot] = LoadRenderTexture(map->chunkTexelSize.x * MAP_CHUNK_SIZE,
+                                                 map->chunkTexelSize.y * MAP_CHUNK_SIZE);
+  }
+  map->chunkCoords[slot] = (Vector2i){chunkX, chunkY};
+  map->chunkLastUsed[slot] = map->frame;
+
+  float texelWidth = (float)map->chunkTexelSize.x;
+  float texelHeight = (float)map->chunkTexelSize.y;
+  BeginTextureMode(map->chunkTextures[slot]);
+  {
+    ClearBackground(BLANK);
+    for (int y = 0; y < MAP_CHUNK_SIZE; y++) {
+      for (int x = 0; x < MAP_CHUNK_SIZE; x++) {
+        int tileX = chunkX * MAP_CHUNK_SIZE + x;
+        int tileY = chunkY * MAP_CHUNK_SIZE + y;
+        if (tileX >= map->width || tileY >= map->height) {
+          continue;
+        }
+        /* Tile art comes from the world atlas, one texture for the whole chunk */
+        Rectangle texels = {x * texelWidth, y * texelHeight, texelWidth, texelHeight};
+        char spriteName[32];
+        snprintf(spriteName, sizeof(spriteName), "tile%d", map->tileTypes[tileY * map->width + tileX]);
+        if (!AssetDrawSprite(&gameState->assets, AssetNameKey(spriteName), texels, WHITE)) {
+          DrawRectangleLinesEx(texels, 1.f, BLACK);
+        }
+      }
+    }
+  }
+  EndTextureMode();
+
+  return slot;
+}
+
+/* Walls and torches from the tile types, once the map is loaded */
+void
+BuildGameMapTiles(GameMap* map)
+{
+  LightMap* light = &map->light;
+  for (int tile = 0; tile < map->tileCount; tile++) {
+    int type = map->tileTypes[tile];
+    if (type < 0 || type >= TILE_TYPE_COUNT) {
+      continue;
+    }
+    const TileProperties* properties = &tileProperties[type];
+    map->solid[tile] = properties->solid;
+    light->opaque[tile] = properties->blocksLight;
+    if (properties->lightRadius > 0 &&
+        LightMapAddLight(light, tile % map->width, tile / map->width, properties->lightRadius,
+                         properties->lightIntensity) == LIGHT_NONE) {
+      printf("More than %d lights on the map, the rest stay dark.\n", LIGHT_MAX_LIGHTS);
+    }
+  }
+
+  /* The light map is drawn, --simulate runs before there's a window */
+  if (!gameState->headless && IsWindowReady()) {
+    LightMapLoadTexture(light);
+  }
+}
+
+/* Only lights that moved or had a tile change under them are cast again */
+void
+UpdateGameMapLight(GameMap* map)
+{
+  EntityStore* entities = &gameState->entities;
+  int playerIndex = EntityIndex(entities, player->entity);
+  if (playerIndex != -1) {
+    int x = (int)(entities->positionX[playerIndex] + entities->sizeX[playerIndex] / 2.f);
+    int y = (int)(entities->positionY[playerIndex] + entities->sizeY[playerIndex] / 2.f);
+    LightMapMoveLight(&map->light, map->playerLight, x, y);
+  }
+
+  LightMapUpdate(&map->light);
+  ProfileCount(&profiler, "light casts", map->light.castCount);
+  ProfileCount(&profiler, "light chunks", map->light.chunkCount);
+}
+
+/* The tile's chunk is baked again, its light only if it blocks differently or is a torch, flow fields if it's solid differently */
+void
+SetGameMapTile(GameMap* map, int tile, int type)
+{
+  int oldType = map->tileTypes[tile];
+  if (oldType == type) {
+    return;
+  }
+  map->tileTypes[tile] = type;
+  int x = tile % map->width;
+  int y = tile / map->width;
+  int slot = FindGameMapChunk(map, x / MAP_CHUNK_SIZE, y / MAP_CHUNK_SIZE);
+  if (slot != -1) {
+    map->chunkCoords[slot] = (Vector2i){-1, -1};
+  }
+
+  TileProperties none = {0};
+  const TileProperties* before = oldType >= 0 && oldType < TILE_TYPE_COUNT ? &tileProperties[oldType] : &none;
+  const TileProperties* after = type >= 0 && type < TILE_TYPE_COUNT ? &tileProperties[type] : &none;
+  if (map->solid[tile] != after->solid) {
+    map->solid[tile] = after->solid;
+    PathGridChanged(&map->path);
+  }
+
+  LightMap* light = &map->light;
+  LightMapSetOpaque(light, x, y, after->blocksLight);
+  if (before->lightRadius > 0) {
+    for (int i = 0; i < light->lightCount; i++) {
+      if (light->lights[i].active && i != map->playerLight && light->lights[i].x == x && light->lights[i].y == y) {
+        LightMapRemoveLight(light, i);
+        break;
+      }
+    }
+  }
+  if (after->lightRadius > 0) {
+    LightMapAddLight(light, x, y, after->lightRadius, after->lightIntensity);
+  }
+}
+
+/* Puts out a torch next to tile x,y or lights one that was put out, the first found of the four sides */
+void
+ToggleTorchNear(GameMap* map, int x, int y)
+{
+  /* the even path directions are the four sides */
+  for (int i = 0; i < 8; i += 2) {
+    int tileX = x + pathDirections[i][0];
+    int tileY = y + pathDirections[i][1];
+    if (tileX < 0 || tileY < 0 || tileX >= map->width || tileY >= map->height) {
+      continue;
+    }
+    int tile = tileY * map->width + tileX;
+    if (map->tileTypes[tile] == TILE_TORCH || map->tileTypes[tile] == TILE_TORCH_OUT) {
+      SetGameMapTile(map, tile, map->tileTypes[tile] == TILE_TORCH ? TILE_TORCH_OUT : TILE_TORCH);
+      return;
+    }
+  }
+}
+
+Rectangle
+GetGameMapTileRect(GameMap* map, int tile)
+{
+  return (Rectangle){(tile % map->width) * map->tileSize.x, (tile / map->width) * map->tileSize.y,
+                     map->tileSize.x, map->tileSize.y};
+}
+
+/* True when a box in tiles overlaps a solid tile, the part outside the map is ignored */
+bool
+GameMapBoxSolid(GameMap* map, float x, float y, float width, float height)
+{
+  int left = (int)floorf(x) > 0 ? (int)floorf(x) : 0;
+  int top = (int)floorf(y) > 0 ? (int)floorf(y) : 0;
+  int right = (int)ceilf(x + width) - 1 < map->width - 1 ? (int)ceilf(x + width) - 1 : map->width - 1;
+  int bottom = (int)ceilf(y + height) - 1 < map->height - 1 ? (int)ceilf(y + height) - 1 : map->height - 1;
+  for (int tileY = top; tileY <= bottom; tileY++) {
+    for (int tileX = left; tileX <= right; tileX++) {
+      if (map->solid[tileY * map->width + tileX]) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/* Recipe index or -1, one hash lookup however many recipes there are */
+int
+FindRecipe(RecipeBook* book, const int* itemIds, int itemCount)
+{
+  if (itemCount <= 0 || itemCount > MAX_RECIPE_INGREDIENTS) {
+    return -1;
+  }
+  uint32_t index = HashMapGet(&book->byIngredients, HashMultiset(itemIds, itemCount));
+  if (index == HASHMAP_NOT_FOUND) {
+    return -1;
+  }
+
+  /* Make sure it isn't a hash collision, compare the ingredient counts per item */
+  const Recipe* recipe = &book->recipes[index];
+  if (recipe->ingredientCount != itemCount) {
+    return -1;
+  }
+  for (int i = 0; i < itemCount; i++) {
+    int wanted = 0;
+    int have = 0;
+    for (int j = 0; j < itemCount; j++) {
+      wanted += recipe->ingredients[j] == itemIds[i];
+      have += itemIds[j] == itemIds[i];
+    }
+    if (wanted != have) {
+      return -1;
+    }
+  }
+  return (int)index;
+}
+
+/* First recipe whose result is resultId or -1, a binary search over the results */
+int
+FindRecipeMaking(RecipeBook* book, int resultId)
+{
+  size_t first;
+  if (SortedIndexFind(&book->byResult, (uint64_t)resultId, &first) == 0) {
+    return -1;
+  }
+  return (int)book->byResult.values[first];
+}
+
+/*
+  The inventory sits where the mouse is minus where it was grabbed,
+  absolute so it tracks the cursor exactly however many frames the drag takes
+*/
+void
+DragInventory(Inventory* inventory)
+{
+  if (!InputMouseDown(MOUSE_BUTTON_LEFT) || !inventory->dragging) {
+    return;
+  }
+  Vector2 position = Vector2Subtract(gameState->mousePosition, inventory->dragOffset);
+  inventory->dragRect.x += position.x - inventory->rect.x;
+  inventory->dragRect.y += position.y - inventory->rect.y;
+  inventory->rect.x = position.x;
+  inventory->rect.y = position.y;
+}
+
+/*
+  printf into the frame arena, the string is good until the next frame.
+  Returns "" when the frame arena is out of space
+*/
+const char*
+FrameTextFormat(const char* format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(NULL, 0, format, args);
+  va_end(args);
+  if (length < 0) {
+    return "";
+  }
+  
+  char* text = (char*)ArenaPush(&frameArena, (size_t)length + 1, 1);
+  if (!text) {
+    return "";
+  }
+  va_start(args, format);
+  vsnprintf(text, (size_t)length + 1, format, args);
+  va_end(args);
+  return text;
+}
+
+/* Arena pushes since the last frame go to the profiler, frame arena bytes are this frame's usage */
+void
+CountFrameAllocations()
+{
+  static size_t lastPushCount;
+  size_t pushCount = permanentArena.pushCount + levelArena.pushCount + frameArena.pushCount;
+  ProfileCount(&profiler, "arena pushes", (double)(pushCount - lastPushCount));
+  ProfileCount(&profiler, "frame arena bytes", (double)frameArena.used);
+  lastPushCount = pushCount;
+}
+
+void
+WriteProfilerTrace(const char* path)
+{
+  if (!ProfilerWriteTrace(&profiler, path)) {
+    printf("%s: failed to write profiler trace.\n", path);
+    return;
+  }
+  printf("Wrote profiler trace to %s.\n", path);
+#if defined (PLATFORM_WEB)
+  DownloadFile(path);
+#endif
+}
+
+/* ENTITY_NONE when MAX_ENTITIES are already alive */
+Entity
+SpawnEntity(EntityKind kind, Vector2 position, Vector2 size, float health)
+{
+  EntityStore* entities = &gameState->entities;
+  Entity entity = EntityCreate(entities, (uint8_t)kind);
+  if (entity == ENTITY_NONE) {
+    return ENTITY_NONE;
+  }
+  int i = EntityIndex(entities, entity);
+  entities->components[i] = COMPONENT_VELOCITY | COMPONENT_HEALTH;
+  entities->positionX[i] = position.x;
+  entities->positionY[i] = position.y;
+  entities->previousX[i] = position.x;
+  entities->previousY[i] = position.y;
+  entities->sizeX[i] = size.x;
+  entities->sizeY[i] = size.y;
+  entities->health[i] = health;
+  entities->maxHealth[i] = health;
+  return entity;
+}
+
+bool
+AddInventoryItem(Inventory* inventory, int itemId)
+{
+  if (inventory->items.length >= MAX_INVENTORY_ITEMS) {
+    return false;
+  }
+  Item item;
+  memset(&item, 0, sizeof(Item));
+  item.id = itemId;
+  char spriteName[32];
+  snprintf(spriteName, sizeof(spriteName), "item%d", itemId);
+  item.sprite = AssetNameKey(spriteName);
+  return ItemListPush(&inventory->items, item) != 0;
+}
+
+bool
+OpenMappedFile(const char* path, MappedFile* file)
+{
+  memset(file, 0, sizeof(MappedFile));
+#if MAP_FILES_WITH_MMAP
+  int fd = open(path, O_RDONLY);
+  if (fd == -1) {
+    return false;
+  }
+  struct stat info;
+  if (fstat(fd, &info) == -1) {
+    close(fd);
+    return false;
+  }
+  file->size = (size_t)info.st_size;
+  if (file->size > 0) {
+    void* data = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      close(fd);
+      return false;
+    }
+    file->data = data;
+    file->mapped = true;
+  }
+  close(fd);
+  return true;
+#else
+  /* No mmap on web/windows, one read of the whole file instead */
+  if (!FileExists(path)) {
+    return false;
+  }
+  int size = 0;
+  file->data = LoadFileData(path, &size);
+  file->size = (size_t)size;
+  return file->data != NULL || size == 0;
+#endif
+}
+
+void
+CloseMappedFile(MappedFile* file)
+{
+#if MAP_FILES_WITH_MMAP
+  if (file->mapped) {
+    munmap(file->data, file->size);
+  }
+#else
+  if (file->data) {
+    UnloadFileData(file->data);
+  }
+#endif
+  memset(file, 0, sizeof(MappedFile));
+}
+
+bool
+LoadGameMap(const char* csvPath, GameMap* map)
+{
+  /* gameMap.csv -> gameMap.map */
+  char cachePath[256];
+  const char* extension = strrchr(csvPath, '.');
+  size_t stemLength = extension ? (size_t)(extension - csvPath) : strlen(csvPath);
+  if (stemLength + sizeof(".map") > sizeof(cachePath)) {
+    printf("%s: map path is too long.\n", csvPath);
+    return false;
+  }
+  memcpy(cachePath, csvPath, stemLength);
+  memcpy(cachePath + stemLength, ".map", sizeof(".map"));
+
+  /* The cache is used unless the csv has been edited since it was written */
+  bool haveCSV = FileExists(csvPath);
+  if (FileExists(cachePath) && (!haveCSV || GetFileModTime(cachePath) >= GetFileModTime(csvPath))) {
+    if (LoadBinaryGameMap(cachePath, map)) {
+      return true;
+    }
+    printf("%s: ignoring map cache, parsing %s instead.\n", cachePath, csvPath);
+  }
+  
+  if (!LoadCSVGameMap(csvPath, map)) {
+    return false;
+  }
+  if (!SaveBinaryGameMap(cachePath, map)) {
+    printf("%s: failed to write map cache.\n", cachePath);
+  }
+  return true;
+}
+
+bool
+LoadBinaryGameMap(const char* path, GameMap* map)
+{
+  MappedFile file;
+  if (!OpenMappedFile(path, &file)) {
+    printf("%s: failed to open map file.\n", path);
+    return false;
+  }
+
+  GameMapFileHeader header;
+  if (file.size < sizeof(GameMapFileHeader)) {
+    printf("%s: map file is too small.\n", path);
+    CloseMappedFile(&file);
+    return false;
+  }
+  memcpy(&header, file.data, sizeof(GameMapFileHeader));
+  
+  if (memcmp(header.magic, MAP_FILE_MAGIC, sizeof(header.magic)) != 0 ||
+      header.version != MAP_FILE_VERSION ||
+      header.width <= 0 || header.height <= 0 ||
+      file.size != sizeof(GameMapFileHeader) + sizeof(int) * (size_t)header.width * header.height)
+  {
+    printf("%s: not a valid version %d map file.\n", path, MAP_FILE_VERSION);
+    CloseMappedFile(&file);
+    return false;
+  }
+
+  /* Tile types are stored raw, no parsing */
+  AllocateGameMap(map, header.width, header.height);
+  memcpy(map->tileTypes, file.data + sizeof(GameMapFileHeader), sizeof(int) * map->tileCount);
+  CloseMappedFile(&file);
+  
+#ifdef DEBUG
+  printf("Map loaded from cache (%dx%d).\n", map->width, map->height);
 #endif
+  return true;
+}
+
+bool
+SaveBinaryGameMap(const char* path, GameMap* map)
+{
+  FILE* file = fopen(path, "wb");
+  if (!file) {
+    return false;
+  }
+
+  GameMapFileHeader header;
+  memcpy(header.magic, MAP_FILE_MAGIC, sizeof(header.magic));
+  header.version = MAP_FILE_VERSION;
+  header.width = map->width;
+  header.height = map->height;
+
+  bool written = fwrite(&header, sizeof(GameMapFileHeader), 1, file) == 1 &&
+                 fwrite(map->tileTypes, sizeof(int), map->tileCount, file) == (size_t)map->tileCount;
+  return (fclose(file) == 0) && written;
+}
+
+bool
+LoadCSVGameMap(const char* path, GameMap* map)
+{
+  MappedFile file;
+  if (!OpenMappedFile(path, &file)) {
+    printf("%s: failed to open map csv file.\n", path);
+    return false;
+  }
+  const char* start = (const char*)file.data;
+  const char* end = start + file.size;
+
+  /*
+    Size the map before parsing, width is the column count of the first
+    row and height is the number of rows that aren't blank
+  */
+  int width = 1;
+  int height = 0;
+  const char* c = start;
+  for (; c < end && *c != '\n'; c++) {
+    if (*c == ',') width++;
+  }
+  bool rowHasData = false;
+  for (c = start; c < end; c++) {
+    if (*c == '\n') {
+      height += rowHasData;
+      rowHasData = false;
+    }
+    else if (*c != ' ' && *c != '\t' && *c != '\r') {
+      rowHasData = true;
+    }
+  }
+  height += rowHasData;
+  
+  if (height == 0) {
+    printf("%s: map csv file is empty.\n", path);
+    CloseMappedFile(&file);
+    return false;
   }
+  
+  AllocateGameMap(map, width, height);
 
-  /* This will be based on size of map*/
-  char line[25];
-  char* linePtr;
+  /* One pass, the end of the file is treated as a final newline */
+  const char* lineStart = start;
+  const char* error = NULL;
+  int line = 1;
   int x = 0;
   int y = 0;
-  int data = 0;
+  int value = 0;
+  bool haveValue = false;
+  bool valueEnded = false;
   
-  while (fgets(line, sizeof(line), file)) {
-    linePtr = &line[0];
+  for (c = start; c <= end && !error; c++) {
+    char character = (c < end) ? *c : '\n';
     
-    while(*linePtr != '\n') {
-      
-      if (*linePtr != ',' && *linePtr != ' ') {
-	data = data * 10 + (*linePtr - 48);
+    if (character >= '0' && character <= '9') {
+      /* whitespace ends a number, "1 2" isn't tile 12 */
+      if (valueEnded) {
+        error = "more than one tile type in a cell";
+        break;
       }
-      else if (*linePtr == ',') {
-	mapBuffer[y][x++].type = data;
-	data = 0;
+      if (value > (INT_MAX - 9) / 10) {
+        error = "tile type is too large";
+        break;
       }
-      
-      linePtr++;
+      value = value * 10 + (character - '0');
+      haveValue = true;
+    }
+    else if (character == ',' || character == '\n') {
+      bool blankRow = (character == '\n' && x == 0 && !haveValue);
+      if (!blankRow) {
+        if (!haveValue) {
+          error = "missing tile type";
+          break;
+        }
+        if (x >= width) {
+          error = "row has more columns than the first row";
+          break;
+        }
+        map->tileTypes[y * width + x++] = value;
+        value = 0;
+        haveValue = false;
+        valueEnded = false;
+        
+        if (character == '\n') {
+          if (x != width) {
+            error = "row has fewer columns than the first row";
+            break;
+          }
+          x = 0;
+          y++;
+        }
+      }
+      if (character == '\n') {
+        line++;
+        lineStart = c + 1;
+      }
+    }
+    else if (character == ' ' || character == '\t' || character == '\r') {
+      valueEnded = haveValue;
+    }
+    else {
+      error = "unexpected character";
+      break;
     }
-    
-    mapBuffer[y][x].type = data;
-    data = 0;
-    y++;
-    x=0;
   }
 
-  fclose(file);
+  if (error) {
+    printf("%s:%d:%d: %s.\n", path, line, (int)(c - lineStart) + 1, error);
+    CloseMappedFile(&file);
+    UnloadGameMap(map);
+    return false;
+  }
+  
+  CloseMappedFile(&file);
   
 #ifdef DEBUG
-  printf("Map loaded.\n");
+  printf("Map loaded (%dx%d).\n", width, height);
 #endif
+  return true;
 }
@@ -0,0 +1,165 @@
+/*
+  Packs sprite pngs into one atlas for includes/assets.h, writes OUT.png and the
+  sprite table OUT.atlas. A sprite's name is its file name without the extension.
+
+  Sprites are sorted tallest first and packed in shelves, rows left to right.
+  The atlas is the smallest power of two square (up to ATLAS_MAX_SIZE) they fit in.
+  Links raylib for image loading and writing only, no window is opened.
+
+  gcc -O2 -std=c99 tools/atlasPacker.c -I raylib/src -L raylib/src -lraylib -lm -o atlasPacker
+  ./atlasPacker src/assets/items art/items/sword.png art/items/potion.png ...
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../includes/assets.h"
+
+#define ATLAS_MIN_SIZE 64
+#define ATLAS_MAX_SIZE 4096
+#define ATLAS_PADDING 1     // transparent texels between sprites so filtering never bleeds
+
+typedef struct PackedSprite
+{
+    const char* path;
+    char name[64];      // GetFileNameWithoutExt returns a static buffer, so it's copied
+    Image image;
+    int x;
+    int y;
+} PackedSprite;
+
+static int
+CompareHeight(const void* a, const void* b)
+{
+    const PackedSprite* first = (const PackedSprite*)a;
+    const PackedSprite* second = (const PackedSprite*)b;
+    if (first->image.height != second->image.height) {
+        return second->image.height - first->image.height;
+    }
+    return second->image.width - first->image.width;
+}
+
+/* Shelf packs into a size x size square, 0 when they don't all fit */
+static int
+Pack(PackedSprite* sprites, int count, int size)
+{
+    int x = 0;
+    int y = 0;
+    int rowHeight = 0;
+    for (int i = 0; i < count; i++) {
+        int width = sprites[i].image.width + ATLAS_PADDING;
+        int height = sprites[i].image.height + ATLAS_PADDING;
+        if (x + width > size) {
+            x = 0;
+            y += rowHeight;
+            rowHeight = 0;
+        }
+        if (width > size || y + height > size) {
+            return 0;
+        }
+        sprites[i].x = x;
+        sprites[i].y = y;
+        x += width;
+        if (height > rowHeight) {
+            rowHeight = height;
+        }
+    }
+    return 1;
+}
+
+int
+main(int argc, char** argv)
+{
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s OUTPUT sprite.png [sprite.png ...]\n", argv[0]);
+        return 1;
+    }
+    SetTraceLogLevel(LOG_WARNING);
+
+    int count = argc - 2;
+    PackedSprite* sprites = (PackedSprite*)calloc((size_t)count, sizeof(PackedSprite));
+    if (!sprites) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (int i = 0; i < count; i++) {
+        sprites[i].path = argv[i + 2];
+        sprites[i].image = LoadImage(sprites[i].path);
+        if (!sprites[i].image.data) {
+            fprintf(stderr, "%s: can't load image\n", sprites[i].path);
+            return 1;
+        }
+        ImageFormat(&sprites[i].image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+        snprintf(sprites[i].name, sizeof(sprites[i].name), "%s", GetFileNameWithoutExt(sprites[i].path));
+    }
+
+    /* Two sprites with one name would make one of them unreachable */
+    for (int i = 0; i < count; i++) {
+        for (int j = i + 1; j < count; j++) {
+            if (strcmp(sprites[i].name, sprites[j].name) == 0) {
+                fprintf(stderr, "%s and %s have the same sprite name\n", sprites[i].path, sprites[j].path);
+                return 1;
+            }
+        }
+    }
+
+    qsort(sprites, (size_t)count, sizeof(PackedSprite), CompareHeight);
+    int size = ATLAS_MIN_SIZE;
+    while (size <= ATLAS_MAX_SIZE && !Pack(sprites, count, size)) {
+        size *= 2;
+    }
+    if (size > ATLAS_MAX_SIZE) {
+        fprintf(stderr, "sprites don't fit in a %dx%d atlas\n", ATLAS_MAX_SIZE, ATLAS_MAX_SIZE);
+        return 1;
+    }
+
+    Image atlas = GenImageColor(size, size, BLANK);
+    for (int i = 0; i < count; i++) {
+        Rectangle source = {0.f, 0.f, (float)sprites[i].image.width, (float)sprites[i].image.height};
+        Rectangle dest = {(float)sprites[i].x, (float)sprites[i].y, source.width, source.height};
+        ImageDraw(&atlas, sprites[i].image, source, dest, WHITE);
+    }
+
+    char path[ASSET_MAX_PATH];
+    snprintf(path, sizeof(path), "%s.png", argv[1]);
+    if (!ExportImage(atlas, path)) {
+        fprintf(stderr, "%s: can't write atlas image\n", path);
+        return 1;
+    }
+
+    snprintf(path, sizeof(path), "%s.atlas", argv[1]);
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        fprintf(stderr, "%s: can't write sprite table\n", path);
+        return 1;
+    }
+    AtlasFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ATLAS_FILE_MAGIC, 4);
+    header.version = ATLAS_FILE_VERSION;
+    header.spriteCount = (uint32_t)count;
+    header.width = (uint32_t)size;
+    header.height = (uint32_t)size;
+    int written = fwrite(&header, sizeof(header), 1, file) == 1;
+    for (int i = 0; written && i < count; i++) {
+        AtlasFileSprite entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.name = AssetNameKey(sprites[i].name);
+        entry.x = (float)sprites[i].x;
+        entry.y = (float)sprites[i].y;
+        entry.width = (float)sprites[i].image.width;
+        entry.height = (float)sprites[i].image.height;
+        written = fwrite(&entry, sizeof(entry), 1, file) == 1;
+    }
+    if (fclose(file) != 0 || !written) {
+        fprintf(stderr, "%s: write failed\n", path);
+        return 1;
+    }
+
+    printf("%s: %d sprites in a %dx%d atlas\n", argv[1], count, size, size);
+    UnloadImage(atlas);
+    for (int i = 0; i < count; i++) {
+        UnloadImage(sprites[i].image);
+    }
+    free(sprites);
+    return 0;
+}
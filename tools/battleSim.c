@@ -0,0 +1,128 @@
+/*
+  Runs battles headless (includes/battle.h) for balance tuning: how often the
+  party wins against the enemies, how many rounds it takes, battles/sec.
+
+  A side is a comma separated list of the units below, both together at most
+  BATTLE_MAX_UNITS. Battle n is seeded with seed + n, a run always repeats.
+
+  gcc -O2 -std=c99 tools/battleSim.c -o battleSim
+  ./battleSim alchemist,homunculus,shadow shade,shade,wraith [battles] [seed]
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include "../includes/battle.h"
+
+#define DEFAULT_BATTLES 100000
+#define MAX_NAME_LENGTH 32
+
+typedef struct UnitPreset
+{
+    const char* name;
+    BattleStats stats;
+} UnitPreset;
+
+/* health, power, defense, crit chance, action */
+static const UnitPreset unitPresets[] = {
+    {"alchemist",   {60.f,  10.f, 2.f, 0.15f, BATTLE_ATTACK}},
+    {"homunculus",  {40.f,   7.f, 1.f, 0.10f, BATTLE_HEAL}},
+    {"shadow",      {35.f,   6.f, 0.f, 0.05f, BATTLE_DRAIN}},     // crafted shadow monster
+    {"golem",       {90.f,   6.f, 5.f, 0.00f, BATTLE_ATTACK}},
+    {"shade",       {30.f,   8.f, 1.f, 0.10f, BATTLE_ATTACK}},
+    {"wraith",      {45.f,   5.f, 3.f, 0.05f, BATTLE_DRAIN}},
+    {"shadowking",  {300.f, 18.f, 4.f, 0.20f, BATTLE_ATTACK}},
+};
+
+static const UnitPreset*
+FindPreset(const char* name)
+{
+    for (int i = 0; i < (int)(sizeof(unitPresets) / sizeof(unitPresets[0])); i++) {
+        if (strcmp(unitPresets[i].name, name) == 0) {
+            return &unitPresets[i];
+        }
+    }
+    return NULL;
+}
+
+/* Adds every unit in the list to the battle, false on an unknown name or too many units */
+static bool
+AddSide(Battle* battle, BattleSide side, const char* list)
+{
+    const char* start = list;
+    while (*start) {
+        const char* end = strchr(start, ',');
+        size_t length = end ? (size_t)(end - start) : strlen(start);
+        char name[MAX_NAME_LENGTH];
+        if (length == 0 || length >= sizeof(name)) {
+            fprintf(stderr, "%s: expected unit names separated by commas\n", list);
+            return false;
+        }
+        memcpy(name, start, length);
+        name[length] = '\0';
+        const UnitPreset* preset = FindPreset(name);
+        if (!preset) {
+            fprintf(stderr, "%s: no such unit\n", name);
+            return false;
+        }
+        if (BattleAdd(battle, side, &preset->stats) == -1) {
+            fprintf(stderr, "more than %d units\n", BATTLE_MAX_UNITS);
+            return false;
+        }
+        start = end ? end + 1 : start + length;
+    }
+    return true;
+}
+
+int
+main(int argc, char** argv)
+{
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s PARTY ENEMIES [battles] [seed]\n", argv[0]);
+        fprintf(stderr, "units:");
+        for (int i = 0; i < (int)(sizeof(unitPresets) / sizeof(unitPresets[0])); i++) {
+            fprintf(stderr, " %s", unitPresets[i].name);
+        }
+        fprintf(stderr, "\n");
+        return 1;
+    }
+    int battles = argc > 3 ? atoi(argv[3]) : DEFAULT_BATTLES;
+    uint64_t seed = argc > 4 ? strtoull(argv[4], NULL, 10) : 1;
+    if (battles <= 0) {
+        fprintf(stderr, "%s: expected a number of battles\n", argv[3]);
+        return 1;
+    }
+
+    /* Units go in once, every battle starts from a copy with its own seed */
+    Battle start;
+    BattleInit(&start, 0);
+    if (!AddSide(&start, BATTLE_PARTY, argv[1]) || !AddSide(&start, BATTLE_ENEMIES, argv[2])) {
+        return 1;
+    }
+
+    long results[3] = {0, 0, 0};
+    long rounds = 0;
+    long partyHealth = 0;
+    clock_t begin = clock();
+    for (int n = 0; n < battles; n++) {
+        Battle battle = start;
+        RngSeed(&battle.rng, seed + (uint64_t)n, 0);
+        int winner = BattleRun(&battle);
+        results[winner]++;
+        rounds += battle.round;
+        for (int i = 0; i < battle.count; i++) {
+            partyHealth += battle.side[i] == BATTLE_PARTY ? (long)battle.health[i] : 0;
+        }
+    }
+    double seconds = (double)(clock() - begin) / CLOCKS_PER_SEC;
+
+    printf("%s against %s, %d battles from seed %llu\n", argv[1], argv[2], battles, (unsigned long long)seed);
+    printf("  party wins %5.1f%%  enemies win %5.1f%%  draws %5.1f%%\n",
+           100.0 * results[BATTLE_PARTY] / battles, 100.0 * results[BATTLE_ENEMIES] / battles,
+           100.0 * results[BATTLE_DRAW] / battles);
+    printf("  %.1f rounds, %.1f party health left on average\n", (double)rounds / battles, (double)partyHealth / battles);
+    printf("  %.0f battles/sec, %.0f rounds/sec\n", seconds > 0.0 ? battles / seconds : 0.0,
+           seconds > 0.0 ? rounds / seconds : 0.0);
+    return 0;
+}
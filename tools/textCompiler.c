@@ -0,0 +1,294 @@
+/*
+  Compiles the game's text files into string table blobs (includes/stringtable.h)
+  and writes the header with the text ids.
+
+  Text files are one `KEY = text` per line, # starts a comment line, \n and \\
+  are the only escapes. The first file is the reference language: its keys, in
+  order, are the ids. Other languages can leave keys out (the game falls back to
+  the reference) but can't add keys the reference doesn't have.
+  Every X.txt is written as X.strings next to it.
+
+  gcc -O2 -std=c99 tools/textCompiler.c -o textCompiler
+  ./textCompiler includes/textids.h src/text/en.txt src/text/es.txt
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../includes/stringtable.h"
+
+#define MAX_KEYS 1024
+#define MAX_KEY_LENGTH 64
+
+typedef struct TextFile
+{
+    char* contents;
+    const char* path;
+    int entryCount;
+    char keys[MAX_KEYS][MAX_KEY_LENGTH];
+    char* values[MAX_KEYS];     // unescaped in place, point into contents
+    int lines[MAX_KEYS];
+} TextFile;
+
+static char*
+ReadWholeFile(const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* contents = (char*)malloc((size_t)size + 1);
+    if (contents && fread(contents, 1, (size_t)size, file) != (size_t)size) {
+        free(contents);
+        contents = NULL;
+    }
+    fclose(file);
+    if (contents) {
+        contents[size] = '\0';
+    }
+    return contents;
+}
+
+static char*
+TrimSpaces(char* start, char* end)
+{
+    while (start < end && (*start == ' ' || *start == '\t')) {
+        start++;
+    }
+    while (end > start && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r')) {
+        end--;
+    }
+    *end = '\0';
+    return start;
+}
+
+/* Unescapes in place, 0 on an unknown escape */
+static int
+Unescape(char* text)
+{
+    char* out = text;
+    for (char* c = text; *c; c++) {
+        if (*c != '\\') {
+            *out++ = *c;
+            continue;
+        }
+        c++;
+        if (*c == 'n') {
+            *out++ = '\n';
+        } else if (*c == '\\') {
+            *out++ = '\\';
+        } else {
+            return 0;
+        }
+    }
+    *out = '\0';
+    return 1;
+}
+
+static int
+FindKey(const TextFile* file, const char* key)
+{
+    for (int i = 0; i < file->entryCount; i++) {
+        if (strcmp(file->keys[i], key) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int
+ParseTextFile(TextFile* file, const char* path)
+{
+    file->path = path;
+    file->entryCount = 0;
+    file->contents = ReadWholeFile(path);
+    if (!file->contents) {
+        fprintf(stderr, "%s: can't read file\n", path);
+        return 0;
+    }
+
+    int lineNumber = 0;
+    char* line = file->contents;
+    while (*line) {
+        lineNumber++;
+        char* end = strchr(line, '\n');
+        char* next = end ? end + 1 : line + strlen(line);
+        if (!end) {
+            end = next;
+        }
+
+        char* text = TrimSpaces(line, end);
+        line = next;
+        if (*text == '\0' || *text == '#') {
+            continue;
+        }
+
+        char* equals = strchr(text, '=');
+        if (!equals) {
+            fprintf(stderr, "%s:%d: expected KEY = text\n", path, lineNumber);
+            return 0;
+        }
+        char* key = TrimSpaces(text, equals);
+        char* value = TrimSpaces(equals + 1, equals + 1 + strlen(equals + 1));
+        size_t keyLength = strlen(key);
+        if (keyLength == 0 || keyLength >= MAX_KEY_LENGTH || strspn(key, "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_") != keyLength) {
+            fprintf(stderr, "%s:%d: keys are upper case letters, digits and _\n", path, lineNumber);
+            return 0;
+        }
+        if (FindKey(file, key) != -1) {
+            fprintf(stderr, "%s:%d: %s is already defined\n", path, lineNumber, key);
+            return 0;
+        }
+        if (file->entryCount == MAX_KEYS) {
+            fprintf(stderr, "%s:%d: more than %d keys\n", path, lineNumber, MAX_KEYS);
+            return 0;
+        }
+        if (!Unescape(value)) {
+            fprintf(stderr, "%s:%d: only \\n and \\\\ are escapes\n", path, lineNumber);
+            return 0;
+        }
+
+        memcpy(file->keys[file->entryCount], key, keyLength + 1);
+        file->values[file->entryCount] = value;
+        file->lines[file->entryCount] = lineNumber;
+        file->entryCount++;
+    }
+    return 1;
+}
+
+static uint64_t
+KeysHash(const TextFile* reference)
+{
+    uint64_t hash = STRING_TABLE_HASH_SEED;
+    for (int i = 0; i < reference->entryCount; i++) {
+        hash = StringTableHashKey(hash, reference->keys[i]);
+    }
+    return hash;
+}
+
+/* Strings in reference order, keys the language doesn't have are STRING_TABLE_MISSING */
+static int
+WriteStringTable(const TextFile* reference, const TextFile* language)
+{
+    for (int i = 0; i < language->entryCount; i++) {
+        if (FindKey(reference, language->keys[i]) == -1) {
+            fprintf(stderr, "%s:%d: %s isn't in %s\n", language->path, language->lines[i],
+                    language->keys[i], reference->path);
+            return 0;
+        }
+    }
+
+    char path[1024];
+    const char* extension = strrchr(language->path, '.');
+    size_t stemLength = extension ? (size_t)(extension - language->path) : strlen(language->path);
+    if (stemLength + sizeof(".strings") > sizeof(path)) {
+        fprintf(stderr, "%s: path is too long\n", language->path);
+        return 0;
+    }
+    memcpy(path, language->path, stemLength);
+    memcpy(path + stemLength, ".strings", sizeof(".strings"));
+
+    static uint32_t offsets[MAX_KEYS];
+    uint32_t dataSize = 0;
+    int missing = 0;
+    for (int i = 0; i < reference->entryCount; i++) {
+        int entry = FindKey(language, reference->keys[i]);
+        if (entry == -1) {
+            offsets[i] = STRING_TABLE_MISSING;
+            missing++;
+            continue;
+        }
+        offsets[i] = dataSize;
+        dataSize += (uint32_t)strlen(language->values[entry]) + 1;
+    }
+
+    StringTableHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, STRING_TABLE_MAGIC, 4);
+    header.version = STRING_TABLE_VERSION;
+    header.count = (uint32_t)reference->entryCount;
+    header.dataSize = dataSize;
+    header.keysHash = KeysHash(reference);
+
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        fprintf(stderr, "%s: can't write file\n", path);
+        return 0;
+    }
+    int written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+        fwrite(offsets, sizeof(uint32_t), (size_t)header.count, file) == header.count;
+    for (int i = 0; written && i < reference->entryCount; i++) {
+        int entry = FindKey(language, reference->keys[i]);
+        if (entry != -1) {
+            written = fwrite(language->values[entry], strlen(language->values[entry]) + 1, 1, file) == 1;
+        }
+    }
+    if (fclose(file) != 0 || !written) {
+        fprintf(stderr, "%s: write failed\n", path);
+        return 0;
+    }
+
+    printf("%s: %d strings, %u bytes of text", path, reference->entryCount - missing, dataSize);
+    if (missing > 0) {
+        printf(", %d falling back to %s", missing, reference->path);
+    }
+    printf("\n");
+    return 1;
+}
+
+static int
+WriteIdHeader(const TextFile* reference, const char* path)
+{
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "%s: can't write file\n", path);
+        return 0;
+    }
+    fprintf(file, "/* Generated by tools/textCompiler.c from %s, don't edit */\n", reference->path);
+    fprintf(file, "#ifndef TEXTIDS_H\n#define TEXTIDS_H\n\n");
+    fprintf(file, "typedef enum TextNames\n{\n");
+    for (int i = 0; i < reference->entryCount; i++) {
+        fprintf(file, "    %s,\n", reference->keys[i]);
+    }
+    fprintf(file, "    TEXT_COUNT,\n} TextNames;\n\n");
+    fprintf(file, "/* String tables compiled from other keys don't load */\n");
+    fprintf(file, "#define TEXT_KEYS_HASH 0x%016llxull\n\n", (unsigned long long)KeysHash(reference));
+    fprintf(file, "/* Key names by id, shown when no loaded language has the string */\n");
+    fprintf(file, "static const char* textKeys[TEXT_COUNT] = {\n");
+    for (int i = 0; i < reference->entryCount; i++) {
+        fprintf(file, "    \"%s\",\n", reference->keys[i]);
+    }
+    fprintf(file, "};\n\n#endif\n");
+    if (fclose(file) != 0) {
+        fprintf(stderr, "%s: write failed\n", path);
+        return 0;
+    }
+    return 1;
+}
+
+int
+main(int argc, char** argv)
+{
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s IDS_HEADER REFERENCE.txt [LANGUAGE.txt ...]\n", argv[0]);
+        return 1;
+    }
+
+    static TextFile reference;
+    static TextFile language;
+    if (!ParseTextFile(&reference, argv[2]) || !WriteIdHeader(&reference, argv[1]) ||
+        !WriteStringTable(&reference, &reference)) {
+        return 1;
+    }
+    for (int i = 3; i < argc; i++) {
+        int compiled = ParseTextFile(&language, argv[i]) && WriteStringTable(&reference, &language);
+        free(language.contents);
+        if (!compiled) {
+            return 1;
+        }
+    }
+    free(reference.contents);
+    return 0;
+}